@@ -0,0 +1,272 @@
+// ---------------------------------------------------------------------------------------------------------- //
+// Osaka University: Dimas M. Rachman, 2022.
+// Coroutine API (C++20) to wait for inputs of the HOTAS, for C++ programs such as TESTWORKX52P.cpp.
+// Saitek/Logitech x52 pro HOTAS.
+
+// REQUIREMENTS
+// Same as TESTWORKX52P.cpp, and a C++20 compiler: in Visual Studio, C/C++ -> Language -> C++ Language Standard,
+// ISO C++20 (/std:c++20). Optional: x52p_ctrl.h and x52p_ctrl.cpp do not need it.
+
+// HOW TO USE
+// Include it after x52p_ctrl.cpp. One x52p_async polls one x52p_ctrl and resumes the coroutines waiting on it,
+// all on the thread that calls Run() (no thread per coroutine, no lock). A coroutine returns x52p_task:
+//
+//		x52p_task Trigger(x52p_async& hotas) {
+//			for (;;) {
+//				co_await hotas.ButtonPressed(0);						// Trigger pulled
+//				double z = co_await hotas.AxisCrossed(2, 0.5);			// Throttle over or under half
+//				unsigned long long f = co_await hotas.NextChange(X52P_FIELD_BIT(X52FieldHat));	// Hat moved
+//			}
+//		}
+//		x52p_ctrl controller(0);
+//		x52p_async hotas(controller);
+//		Trigger(hotas);		// Runs to its first co_await
+//		hotas.Run(0.001);	// Polls every ms until no coroutine waits
+//
+// NextChange(mask) resumes at the first poll where a field of mask changed (fields numbered as X52StateDiff(),
+// axes exactly, not through x52p_gate) and gives the changed fields of mask. ButtonPressed(id) resumes when the
+// button goes down. AxisCrossed(axis, threshold) resumes when the normalized axis (as XJoy(), ...) goes from one
+// side of threshold to the other, and gives its new value.
+// The awaiters live in the coroutine frames: waiting allocates nothing. They are kept in one list per field
+// (button, axis), a poll costs one X52StateDiff() and looks at the lists of the changed fields only, plus the
+// NextChange() ones. The axes are normalized only when an AxisCrossed() waits.
+// ---------------------------------------------------------------------------------------------------------- //
+
+
+#ifndef X52P_ASYNC_H
+#define X52P_ASYNC_H
+
+#if !(__cplusplus >= 202002L || (defined(_MSVC_LANG) && _MSVC_LANG >= 202002L))
+#error "x52p_async.h needs C++20 coroutines, compile with /std:c++20"
+#endif
+
+#include <coroutine>
+#include <exception>
+
+#define X52P_FIELD_BIT(field) (1ULL << (field))	// Bit of a field of X52StateDiff() for NextChange()
+
+// Return type of a coroutine waiting on the HOTAS: starts at once, its frame is freed when it ends
+struct x52p_task
+{
+	struct promise_type
+	{
+		x52p_task get_return_object() { return {}; }
+		std::suspend_never initial_suspend() noexcept { return {}; }
+		std::suspend_never final_suspend() noexcept { return {}; }
+		void return_void() {}
+		void unhandled_exception() { std::terminate(); }	// No exceptions in this code
+	};
+};
+
+class x52p_async;
+
+// One waiting coroutine and its condition, in the frame of the coroutine (see the awaiters below)
+enum X52WaitKind { X52_WAIT_CHANGE, X52_WAIT_BUTTON, X52_WAIT_AXIS };
+
+struct X52Waiter
+{
+	X52Waiter* next;
+	std::coroutine_handle<> handle;
+	int kind;			// X52WaitKind
+	int index;			// Button or axis
+	double threshold;
+	unsigned long long mask;	// Fields for X52_WAIT_CHANGE
+	unsigned long long fields;	// Changed fields of mask, when resumed
+	double value;				// Axis value, when resumed
+};
+
+class x52p_async {
+public:
+	explicit x52p_async(x52p_ctrl& controller) : c(controller) {}
+	~x52p_async();		// Frees the frames of the coroutines still waiting
+
+	// Awaiters, co_await them in an x52p_task
+	struct ChangeAwaiter : X52Waiter
+	{
+		x52p_async* owner;
+		bool await_ready() { return false; }
+		void await_suspend(std::coroutine_handle<> h) { handle = h; owner->Add(this); }
+		unsigned long long await_resume() { return fields; }
+	};
+	struct ButtonAwaiter : X52Waiter
+	{
+		x52p_async* owner;
+		bool await_ready() { return false; }
+		void await_suspend(std::coroutine_handle<> h) { handle = h; owner->Add(this); }
+		void await_resume() {}
+	};
+	struct AxisAwaiter : X52Waiter
+	{
+		x52p_async* owner;
+		bool await_ready() { return false; }
+		void await_suspend(std::coroutine_handle<> h) { handle = h; owner->Add(this); }
+		double await_resume() { return value; }
+	};
+
+	ChangeAwaiter NextChange(unsigned long long mask);
+	ButtonAwaiter ButtonPressed(int id);
+	AxisAwaiter AxisCrossed(int axis, double threshold);
+
+	int Poll();		// One poll of the device (Poll() of x52p_ctrl), resumes the coroutines due, returns how many
+	void Run(double period);	// Polls every period seconds (0: as fast as possible) while a coroutine waits
+	int GetWaiting();
+
+private:
+	void Add(X52Waiter* w);
+	void TakeDue(X52Waiter** list, unsigned long long diff, unsigned long long pressed, const double* axes, X52Waiter** due);
+
+	x52p_ctrl& c;
+	X52Waiter* lists[X52FieldButton0 + ButtonCount] = { NULL };	// Per field: AxisCrossed(), ButtonPressed()
+	X52Waiter* changes = NULL;	// NextChange(), any fields
+	int count = 0, axisWaiters = 0;
+	X52State last = { 0, { 0 }, X52HatCentered, 0 };	// State of the last poll
+	double lastAxes[AxisCount] = { 0 };
+	int valid = 0;
+};
+
+inline x52p_async::~x52p_async() {
+	for (int f = 0; f <= X52FieldButton0 + ButtonCount; ++f) {
+		X52Waiter*& list = (f < X52FieldButton0 + ButtonCount) ? lists[f] : changes;
+		while (list != NULL) {
+			X52Waiter* w = list;
+			list = w->next;
+			w->handle.destroy();	// The awaiter is in this frame, read next before
+		}
+	}
+}
+
+inline x52p_async::ChangeAwaiter x52p_async::NextChange(unsigned long long mask) {
+	ChangeAwaiter a = {};
+	a.kind = X52_WAIT_CHANGE;
+	a.mask = mask;
+	a.owner = this;
+	return a;
+}
+
+inline x52p_async::ButtonAwaiter x52p_async::ButtonPressed(int id) {
+	ButtonAwaiter a = {};
+	a.kind = X52_WAIT_BUTTON;
+	a.index = id;
+	a.owner = this;
+	return a;
+}
+
+inline x52p_async::AxisAwaiter x52p_async::AxisCrossed(int axis, double threshold) {
+	AxisAwaiter a = {};
+	a.kind = X52_WAIT_AXIS;
+	a.index = axis;
+	a.threshold = threshold;
+	a.owner = this;
+	return a;
+}
+
+inline void x52p_async::Add(X52Waiter* w) {
+	X52Waiter** list = (w->kind == X52_WAIT_CHANGE) ? &changes :
+		&lists[(w->kind == X52_WAIT_BUTTON) ? X52FieldButton0 + w->index : w->index];
+	w->next = *list;
+	*list = w;
+	++count;
+	if (w->kind == X52_WAIT_AXIS && axisWaiters++ == 0 && valid) {
+		c.NormalizeAxes(&last, lastAxes);	// Not kept while nobody waited on an axis
+	}
+}
+
+inline int x52p_async::GetWaiting() {
+	return count;
+}
+
+// The conditions are checked against the last poll: the first poll only takes the state
+inline int x52p_async::Poll() {
+	if (!c.Poll()) {
+		return 0;
+	}
+	const X52State& now = c.GetCompactState();
+	double axes[AxisCount];
+	int haveAxes = (axisWaiters > 0);	// lastAxes is kept only while an AxisCrossed() waits
+	if (haveAxes) {
+		c.GetAxes(axes);
+	}
+	if (!valid) {
+		last = now;
+		if (haveAxes) {
+			memcpy(lastAxes, axes, sizeof(axes));
+		}
+		valid = 1;
+		return 0;
+	}
+	unsigned long long diff = X52StateDiff(&last, &now);
+	if (diff == 0) {
+		return 0;	// Nothing can be due
+	}
+	unsigned long long pressed = now.buttons & ~last.buttons;
+
+	// Take the due ones out first: a resumed coroutine can wait again, for the next poll
+	X52Waiter* due = NULL;
+	TakeDue(&changes, diff, pressed, axes, &due);
+	for (unsigned long long left = diff; left != 0; left &= left - 1) {
+		TakeDue(&lists[LowestBit(left)], diff, pressed, axes, &due);
+	}
+	last = now;
+	if (haveAxes) {
+		memcpy(lastAxes, axes, sizeof(axes));
+	}
+
+	int resumed = 0;
+	while (due != NULL) {
+		X52Waiter* w = due;
+		due = w->next;	// Before the resume, the frame may be gone after it
+		w->handle.resume();
+		++resumed;
+	}
+	return resumed;
+}
+
+// Move the waiters of a list whose condition holds to due
+inline void x52p_async::TakeDue(X52Waiter** link, unsigned long long diff, unsigned long long pressed, const double* axes, X52Waiter** due) {
+	while (*link != NULL) {
+		X52Waiter* w = *link;
+		int ready = 0;
+		switch (w->kind) {
+		case X52_WAIT_CHANGE:
+			w->fields = diff & w->mask;
+			ready = (w->fields != 0);
+			break;
+		case X52_WAIT_BUTTON:
+			ready = (int)(pressed >> w->index & 1);
+			break;
+		case X52_WAIT_AXIS:		// Its field changed, lastAxes and axes are there (haveAxes)
+			ready = ((lastAxes[w->index] < w->threshold) != (axes[w->index] < w->threshold));
+			w->value = axes[w->index];
+			break;
+		}
+		if (ready) {
+			*link = w->next;
+			w->next = *due;
+			*due = w;
+			--count;
+			axisWaiters -= (w->kind == X52_WAIT_AXIS);
+		}
+		else {
+			link = &w->next;
+		}
+	}
+}
+
+// Absolute deadlines, the same wait as the sampler (see X52SleepUntil())
+inline void x52p_async::Run(double period) {
+	long long periodNs = (long long)(period * 1e9);
+	HANDLE timer = (periodNs > 0) ? X52CreateTimer() : NULL;	// For X52SleepUntil(), closed on return
+	long long next = x52p_now_ns();
+	while (count > 0) {
+		Poll();
+		if (periodNs > 0) {
+			next += periodNs;
+			X52SleepUntil(next, timer, SamplerSpinNs);
+		}
+	}
+	if (timer != NULL) {
+		CloseHandle(timer);
+	}
+}
+
+#endif
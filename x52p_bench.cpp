@@ -0,0 +1,607 @@
+// ---------------------------------------------------------------------------------------------------------- //
+// Osaka University: Dimas M. Rachman, 2022.
+// Microbenchmarks of the step paths of x52p_ctrl, to check a change does not slow down a 1 kHz step.
+// Saitek/Logitech x52 pro HOTAS.
+
+// REQUIREMENTS
+// Same as TESTWORKX52P.cpp: x52p_ctrl.h, x52p_ctrl.cpp, x52p_standin.h, and the DirectX SDK and DirectOutput
+// files to compile. No HOTAS is needed to run it, the game controller is a stand-in (x52p_standin.h).
+// Compile with optimizations (Release), the numbers of a Debug build mean nothing. The async benchmark needs
+// C++20 (/std:c++20, see x52p_async.h), it is left out of a build with an older standard.
+
+// HOW TO USE
+// x52p_bench [name ...]		runs the named benchmarks, all of them without a name
+//		mfd		MFDFormatValue(), one "LABEL    value UNIT" line
+//		map		x52p_map::Eval() of 50 and 500 rules (axes, buttons, toggles, trims, hat) on two layers
+//		state	X52StateFromDI(), X52StateToDI(), X52StateDiff() on random states, against the per-byte button
+//				loop they replace, and a copy of the compact state against a copy of DIJOYSTATE2
+//		subs	x52p_subs::Dispatch() to 500 subscribers of 1 to 3 fields each, against every subscriber diffing
+//				the state itself, on a sequence of small changes
+//		async	x52p_async::Poll() with the resume of one coroutine, with 1 and 1000 waiters, against GetState(),
+//				then the wake-up latency of a button press (from another thread) with Run(0), Run(0.001), and a
+//				GetState() spin loop
+//		event	reads of a slow stick (new input from another thread every 5 ms), then of a still one: latency
+//				of each input and CPU time of the reading thread, WaitForInput() against GetState() spinning and
+//				GetState() with Sleep(1)
+//		output	cost of one LED write, then a 1 kHz loop of 2 s per output budget (none, 100/s, 300/s): bursts of
+//				MFD and LED changes, and a warning LED toggled, DirectOutput calls made and warning latency
+// Times are per call, averaged over many calls, on this machine. Compare runs of the same machine only.
+// ---------------------------------------------------------------------------------------------------------- //
+
+#include "x52p_ctrl.h"				// External dependency file, header file
+#include "x52p_ctrl.cpp"			// Functions definitions
+#include "x52p_standin.h"			// Stand-in DirectInput and DirectOutput
+#if __cplusplus >= 202002L || (defined(_MSVC_LANG) && _MSVC_LANG >= 202002L)
+#define X52P_BENCH_ASYNC
+#include "x52p_async.h"				// Coroutines, C++20
+#endif
+
+const double StepNs = 1e6;			// A 1 kHz step, for the share of the step
+
+// Print one result, time per call and share of a 1 kHz step
+void Report(const char* what, double ns) {
+	printf("  %-40s %10.1f ns  %8.4f%% of a 1 kHz step\n", what, ns, 100.0 * ns / StepNs);
+}
+
+//////////////////////////// MFD FORMAT ///////////////////////////////////
+void BenchMFD() {
+	const int Lines = 1000000;
+	MFDLine line;
+	volatile DWORD sink = 0;	// Keeps the lines from being optimized away
+
+	MFDFormatValue(&line, L"ALT", 1250.04, 1, L"M");
+	printf("mfd: \"%ls\"\n", line.text);
+	long long t0 = x52p_now_ns();
+	for (int i = 0; i < Lines; ++i) {
+		MFDFormatValue(&line, L"ALT", i * 0.37, 1, L"M");
+		sink = sink + line.length;
+	}
+	long long t1 = x52p_now_ns();
+	Report("MFDFormatValue() per line", double(t1 - t0) / Lines);
+}
+
+//////////////////////////// INPUT MAPPING //////////////////////////////
+void BenchMap() {
+	const int Evals = 200000;
+	const int sizes[] = { 50, 500 };
+	static MapRule rules[MapMaxRules];
+	static x52p_map map;
+	double out[MapMaxOutputs];
+
+	StandinReset(1);
+	x52p_ctrl* c = new x52p_ctrl(0);
+	standin[0].state.lX = 65535;
+	standin[0].state.rgdwPOV[0] = 9000;		// Hat right
+	standin[0].state.rgbButtons[5] = 0x80;	// Pinkie held: the shift layer
+	c->GetState();
+
+	printf("map:\n");
+	for (int n : sizes) {
+		for (int i = 0; i < n; ++i) {	// Every rule type, a third of them on the pinkie layer
+			rules[i].type = i % 6;
+			rules[i].src = (i % 6 == MAP_AXIS) ? i % AxisCount : i % ButtonCount;
+			rules[i].src2 = -1;
+			rules[i].layer = (i % 3 == 0) ? 5 : MAP_NO_LAYER;
+			rules[i].out = i % 100;
+			rules[i].gain = 1.0;
+		}
+		if (map.Compile(rules, n) >= 0) {
+			printf("  rules not compiled\n");
+			break;
+		}
+		long long t0 = x52p_now_ns();
+		for (int k = 0; k < Evals; ++k) {
+			map.Eval(c, 0.001, out);
+		}
+		long long t1 = x52p_now_ns();
+		char what[64];
+		snprintf(what, sizeof(what), "Eval() of %d rules", n);
+		Report(what, double(t1 - t0) / Evals);
+	}
+	delete c;
+}
+
+//////////////////////////// COMPACT STATE ////////////////////////////////
+// The button mask as it was built before X52State, one byte at a time
+unsigned long long ButtonLoop(const DIJOYSTATE2* s) {
+	unsigned long long mask = 0;
+	for (int i = 0; i < ButtonCount; ++i) {
+		if (s->rgbButtons[i] & 0x80) {
+			mask |= 1ULL << i;
+		}
+	}
+	return mask;
+}
+
+void BenchState() {
+	const int States = 4096, Rounds = 2000;
+	static DIJOYSTATE2 di[States], back[64];
+	static X52State cs[States];
+	unsigned int seed = 3;
+	volatile unsigned long long sink = 0;
+
+	for (int i = 0; i < States; ++i) {	// Random axes, buttons, and hat
+		DIJOYSTATE2* s = &di[i];
+		ZeroMemory(s, sizeof(DIJOYSTATE2));
+		LONG* axes = &s->lX;
+		for (int a = 0; a < 8; ++a) {	// X to RZ and the two sliders
+			seed = seed * 1103515245 + 12345;
+			axes[a] = seed >> 16;
+		}
+		for (int b = 0; b < ButtonCount; ++b) {
+			seed = seed * 1103515245 + 12345;
+			s->rgbButtons[b] = (seed >> 16 & 1) ? 0x80 : 0;
+		}
+		seed = seed * 1103515245 + 12345;
+		s->rgdwPOV[0] = (seed >> 16) % 9 == 8 ? 0xFFFFFFFF : (seed >> 16) % 8 * 4500;
+		s->rgdwPOV[1] = s->rgdwPOV[2] = s->rgdwPOV[3] = 0xFFFFFFFF;
+	}
+	int bad = 0;	// The round trip gives the same state, and the same buttons as the old loop
+	for (int i = 0; i < States; ++i) {
+		X52State again;
+		X52StateFromDI(&di[i], &cs[i]);
+		X52StateToDI(&cs[i], &back[0]);
+		X52StateFromDI(&back[0], &again);
+		bad += (memcmp(&again, &cs[i], sizeof(X52State)) != 0 || (cs[i].buttons & X52ButtonBits) != ButtonLoop(&di[i]));
+	}
+	printf("state: %d random states, %d round trip mismatches, %d bytes against %d\n", States, bad,
+		(int)sizeof(X52State), (int)sizeof(DIJOYSTATE2));
+
+	double n = double(Rounds) * States;
+	long long t0 = x52p_now_ns();
+	for (int r = 0; r < Rounds; ++r) {
+		for (int i = 0; i < States; ++i) {
+			X52StateFromDI(&di[i], &cs[i]);
+		}
+	}
+	long long t1 = x52p_now_ns();
+	for (int r = 0; r < Rounds; ++r) {
+		for (int i = 0; i < States; ++i) {
+			X52StateToDI(&cs[i], &back[i & 63]);
+		}
+	}
+	long long t2 = x52p_now_ns();
+	for (int r = 0; r < Rounds; ++r) {
+		for (int i = 1; i < States; ++i) {
+			sink = sink + X52StateDiff(&cs[i - 1], &cs[i]);
+		}
+	}
+	long long t3 = x52p_now_ns();
+	for (int r = 0; r < Rounds; ++r) {
+		for (int i = 0; i < States; ++i) {
+			sink = sink + ButtonLoop(&di[i]);
+		}
+	}
+	long long t4 = x52p_now_ns();
+	for (int r = 0; r < Rounds; ++r) {
+		for (int i = 0; i < States; ++i) {
+			cs[i] = cs[(i + 7) % States];
+		}
+	}
+	long long t5 = x52p_now_ns();
+	for (int r = 0; r < Rounds / 8; ++r) {	// Fewer rounds, the copies are large
+		for (int i = 0; i < States; ++i) {
+			di[i] = di[(i + 7) % States];
+		}
+	}
+	long long t6 = x52p_now_ns();
+	Report("X52StateFromDI()", (t1 - t0) / n);
+	Report("X52StateToDI()", (t2 - t1) / n);
+	Report("X52StateDiff()", (t3 - t2) / n);
+	Report("button loop, per byte (before X52State)", (t4 - t3) / n);
+	Report("copy of X52State", (t5 - t4) / n);
+	Report("copy of DIJOYSTATE2", (t6 - t5) / (n / 8));
+}
+
+//////////////////////////// SUBSCRIBERS //////////////////////////////////
+static long long subsCalls = 0;
+
+void OnSubsChange(void* user, const X52State* s, unsigned long long fields) {
+	++subsCalls;
+}
+
+void BenchSubs() {
+	const int Subscribers = 500, Changes = 1000, Dispatches = 1000000;
+	static x52p_subs subs;
+	static unsigned long long masks[SubsMax];
+	static X52State seq[Changes], last[SubsMax];
+	unsigned int seed = 1;
+
+	for (int i = 0; i < Subscribers; ++i) {	// 1 to 3 random fields each
+		seed = seed * 1103515245 + 12345;
+		int fields = 1 + (seed >> 16) % 3;
+		masks[i] = 0;
+		for (int k = 0; k < fields; ++k) {
+			seed = seed * 1103515245 + 12345;
+			masks[i] |= 1ULL << ((seed >> 16) % SubsFields);
+		}
+		subs.Subscribe(masks[i], OnSubsChange, NULL);
+	}
+	X52State s = { 0, { 32767, 32767, 65535, 0, 0, 32767, 0 }, X52HatCentered, 0 };	// Stick released
+	const X52State start = s;
+	subs.Dispatch(&start);
+	for (int t = 0; t < Changes; ++t) {	// One or two fields changed per poll
+		seed = seed * 1103515245 + 12345;
+		int fields = 1 + (seed >> 16) % 2;
+		for (int k = 0; k < fields; ++k) {
+			seed = seed * 1103515245 + 12345;
+			int f = (seed >> 16) % SubsFields;
+			if (f < AxisCount) {
+				s.axes[f] += 1 + (seed >> 8) % 50;
+			}
+			else if (f == X52FieldHat) {
+				s.hat = (s.hat == X52HatCentered) ? 0 : X52HatCentered;
+			}
+			else if (f == X52FieldMode) {
+				s.mode ^= 1;
+			}
+			else {
+				s.buttons ^= 1ULL << (f - X52FieldButton0);
+			}
+		}
+		seq[t] = s;
+	}
+
+	long long expected = 0;	// Callbacks the subscribers should get for one pass of the sequence
+	X52State prev = start;
+	for (int t = 0; t < Changes; ++t) {
+		unsigned long long d = X52StateDiff(&prev, &seq[t]);
+		for (int i = 0; i < Subscribers; ++i) {
+			expected += (d & masks[i]) != 0;
+		}
+		prev = seq[t];
+	}
+	subsCalls = 0;
+	for (int t = 0; t < Changes; ++t) {
+		subs.Dispatch(&seq[t]);
+	}
+	printf("subs: %d subscribers, %lld callbacks for %lld expected\n", Subscribers, subsCalls, expected);
+
+	long long t0 = x52p_now_ns();
+	for (int t = 0; t < Dispatches; ++t) {
+		subs.Dispatch(&seq[t % Changes]);
+	}
+	long long t1 = x52p_now_ns();
+	for (int i = 0; i < Subscribers; ++i) {	// Naive: each subscriber keeps its last state and diffs it
+		last[i] = seq[Changes - 1];
+	}
+	long long t2 = x52p_now_ns();
+	for (int t = 0; t < Dispatches; ++t) {
+		const X52State* n = &seq[t % Changes];
+		for (int i = 0; i < Subscribers; ++i) {
+			unsigned long long d = X52StateDiff(&last[i], n) & masks[i];
+			if (d != 0) {
+				OnSubsChange(NULL, n, d);
+			}
+			last[i] = *n;
+		}
+	}
+	long long t3 = x52p_now_ns();
+	Report("Dispatch() to the subscribers", double(t1 - t0) / Dispatches);
+	Report("every subscriber diffing (naive)", double(t3 - t2) / Dispatches);
+}
+
+//////////////////////////// COROUTINES ///////////////////////////////////
+#ifdef X52P_BENCH_ASYNC
+static std::atomic<long long> pressedAt{ 0 };	// Time of the last press of button 0, by the pressing thread
+
+x52p_task CountChanges(x52p_async& h, long long* resumes) {
+	for (;;) {
+		co_await h.NextChange(X52P_FIELD_BIT(X52FieldButton0));
+		++*resumes;
+	}
+}
+
+x52p_task WaitIdle(x52p_async& h, int button) {
+	for (;;) {
+		co_await h.ButtonPressed(button);	// Never pressed, only there to be looked at
+	}
+}
+
+// Wake-up latency of wakes presses of button 0, ends after them (Run() returns)
+x52p_task TimePresses(x52p_async& h, int wakes, double* sum, double* worst) {
+	for (int i = 0; i < wakes; ++i) {
+		co_await h.ButtonPressed(0);
+		double d = double(x52p_now_ns() - pressedAt.load());
+		*sum += d;
+		*worst = (d > *worst) ? d : *worst;
+	}
+}
+
+// Press and release button 0 every 2 ms until stop
+void PressButton(std::atomic<bool>* stop) {
+	DIJOYSTATE2 st = standin[0].state;
+	while (!stop->load()) {
+		Sleep(1);
+		st.rgbButtons[0] = 0x80;
+		pressedAt = x52p_now_ns();
+		StandinSetInput(0, &st);
+		Sleep(1);
+		st.rgbButtons[0] = 0;
+		StandinSetInput(0, &st);
+	}
+}
+
+void ReportLatency(const char* what, double sum, double worst, int n) {
+	printf("  %-40s mean %8.1f us  worst %8.1f us\n", what, sum / n * 1e-3, worst * 1e-3);
+}
+
+void BenchAsync() {
+	const int Polls = 200000, Idle = 999, Wakes = 200;
+	StandinReset(1);
+	x52p_ctrl* c = new x52p_ctrl(0);
+	printf("async:\n");
+
+	long long t0 = x52p_now_ns();
+	for (int i = 0; i < Polls; ++i) {	// The device changes at every poll, one thread: no StandinSetInput()
+		standin[0].state.rgbButtons[0] = (i & 1) ? 0x80 : 0;
+		c->GetState();
+	}
+	Report("GetState(), changed state", double(x52p_now_ns() - t0) / Polls);
+	for (int waiters = 1; waiters <= Idle + 1; waiters += Idle) {
+		x52p_async h(*c);
+		long long resumes = 0;
+		CountChanges(h, &resumes);
+		for (int i = 1; i < waiters; ++i) {
+			WaitIdle(h, 1 + i % (ButtonCount - 1));	// Spread over the other buttons
+		}
+		t0 = x52p_now_ns();
+		for (int i = 0; i < Polls; ++i) {
+			standin[0].state.rgbButtons[0] = (i & 1) ? 0 : 0x80;
+			h.Poll();
+		}
+		char what[64];
+		snprintf(what, sizeof(what), "Poll() and resume, %d waiter%s", waiters, (waiters > 1) ? "s" : "");
+		Report(what, double(x52p_now_ns() - t0) / Polls);
+		if (resumes < Polls - 1) {
+			printf("  %lld resumes for %d changes\n", resumes, Polls - 1);
+		}
+	}
+
+	std::atomic<bool> stop{ false };
+	std::thread presser(PressButton, &stop);
+	const double periods[] = { 0, 0.001 };
+	for (double period : periods) {
+		x52p_async h(*c);
+		double sum = 0, worst = 0;
+		TimePresses(h, Wakes, &sum, &worst);
+		h.Run(period);
+		ReportLatency(period > 0 ? "wake-up latency, Run(0.001)" : "wake-up latency, Run(0)", sum, worst, Wakes);
+	}
+	double sum = 0, worst = 0;
+	int wakes = 0, prev = 1;
+	while (wakes < Wakes) {		// The loop without coroutines: read all the time, look at the button
+		c->GetState();
+		int now = c->IsButtonPressed(0);
+		if (now && !prev) {
+			double d = double(x52p_now_ns() - pressedAt.load());
+			sum += d;
+			worst = (d > worst) ? d : worst;
+			++wakes;
+		}
+		prev = now;
+	}
+	ReportLatency("wake-up latency, GetState() spin loop", sum, worst, Wakes);
+	stop = true;
+	presser.join();
+	delete c;
+}
+#endif
+
+//////////////////////////// INPUT EVENT //////////////////////////////////
+const int EventInputs = 200;		// New inputs, one every EventPeriodMs
+const int EventPeriodMs = 5;
+const long long EventIdleNs = 500000000;	// Then this long without input
+static std::atomic<long long> inputAt[EventInputs + 1];	// Time of the input k (X = k)
+
+enum EventRead { READ_EVENT, READ_SPIN, READ_SLEEP };
+static const char* const eventReads[] = { "WaitForInput(0.1)", "GetState() spin loop", "GetState() and Sleep(1)" };
+
+// CPU time (s) of the calling thread, user and kernel
+double ThreadCpu() {
+	FILETIME created, ended, kernel, user;
+	GetThreadTimes(GetCurrentThread(), &created, &ended, &kernel, &user);
+	double high = double(kernel.dwHighDateTime) + double(user.dwHighDateTime);
+	return (high * 4294967296.0 + kernel.dwLowDateTime + user.dwLowDateTime) * 1e-7;	// In 100 ns
+}
+
+// A slow stick: X goes 1, 2, ... EventInputs, one every EventPeriodMs
+void FeedInput() {
+	DIJOYSTATE2 st = standin[0].state;
+	for (int k = 1; k <= EventInputs; ++k) {
+		Sleep(EventPeriodMs);
+		st.lX = k;
+		inputAt[k] = x52p_now_ns();
+		StandinSetInput(0, &st);
+	}
+}
+
+// One read as the loop of a model does it (EventRead)
+void ReadOnce(x52p_ctrl* c, int read) {
+	if (read == READ_EVENT) {
+		c->WaitForInput(0.1);
+		return;
+	}
+	c->GetState();
+	if (read == READ_SLEEP) {
+		Sleep(1);
+	}
+}
+
+void BenchEvent() {
+	StandinReset(1);
+	x52p_ctrl* c = new x52p_ctrl(0);
+	printf("event: %d inputs, one every %d ms, then %d ms without input\n", EventInputs, EventPeriodMs,
+		int(EventIdleNs / 1000000));
+	for (int read = READ_EVENT; read <= READ_SLEEP; ++read) {
+		if (read == READ_EVENT && !c->SetInputEvent(1)) {
+			printf("  no input event on the device\n");
+			continue;
+		}
+		DIJOYSTATE2 st = standin[0].state;
+		st.lX = 0;
+		StandinSetInput(0, &st);
+		c->GetState();
+
+		double sum = 0, worst = 0;
+		int seen = 0, last = 0;
+		std::thread feeder(FeedInput);
+		long long t0 = x52p_now_ns();
+		double cpu0 = ThreadCpu();
+		while (last < EventInputs) {
+			ReadOnce(c, read);
+			int x = c->GetCompactState().axes[0];
+			if (x != last) {
+				double d = double(x52p_now_ns() - inputAt[x].load());
+				sum += d;
+				worst = (d > worst) ? d : worst;
+				++seen;
+				last = x;
+			}
+		}
+		double busy = (ThreadCpu() - cpu0) / ((x52p_now_ns() - t0) * 1e-9);
+		feeder.join();
+
+		t0 = x52p_now_ns();
+		cpu0 = ThreadCpu();
+		while (x52p_now_ns() - t0 < EventIdleNs) {
+			ReadOnce(c, read);
+		}
+		double idle = (ThreadCpu() - cpu0) / ((x52p_now_ns() - t0) * 1e-9);
+		c->SetInputEvent(0);
+		printf("  %-24s latency mean %7.1f us worst %7.1f us, %3d inputs seen, CPU %5.1f%% moving %5.1f%% still\n",
+			eventReads[read], sum / seen * 1e-3, worst * 1e-3, seen, 100 * busy, 100 * idle);
+	}
+	delete c;
+}
+
+//////////////////////////// OUTPUT SCHEDULER /////////////////////////////
+void BenchOutput() {
+	const int Writes = 100000, Steps = 2000;	// The loop: 2 s at 1 kHz
+	const double rates[] = { 0, 100, 300 };
+	const DWORD Warning = 1;	// Button A, red and green, the warning LED
+
+	StandinReset(1);
+	printf("output:\n");
+	x52p_ctrl* c = new x52p_ctrl(0);
+	long long t0 = x52p_now_ns();
+	for (int i = 0; i < Writes; ++i) {
+		if (i & 1) {
+			c->SetLEDPressRed(3);
+		}
+		else {
+			c->SetLEDOff(3);	// Red and green
+		}
+	}
+	long long t1 = x52p_now_ns();
+	Report("LED write, no budget, per call", double(t1 - t0) / Writes);
+	delete c;
+
+	printf("  1 kHz loop, 2 s, 10-step bursts (3 MFD lines, 7 LEDs) every 100 steps, warning every 250 steps\n");
+	HANDLE timer = X52CreateTimer();
+	for (double rate : rates) {
+		c = new x52p_ctrl(0);
+		c->SetOutputBudget(rate, 8);
+		c->SetLEDPriority(Warning, OUT_PRIO_WARNING);
+		OutputStats before, after;
+		c->GetOutputStats(&before);
+		long long calls = standinWrites, warnTime = -1, worst = 0, sum = 0;
+		int warnings = 0;
+		DWORD warnOn = 0;
+		unsigned int seed = 1;
+		MFDLine line;
+		long long next = x52p_now_ns();
+		for (int step = 0; step < Steps; ++step) {
+			if (step % 100 < 10) {
+				for (int pos = 0; pos < MFDLines; ++pos) {
+					MFDFormatValue(&line, L"V", step * 0.1 + pos, 1, L"M");
+					c->SetMFDLine(0, pos, &line);
+				}
+				for (DWORD b = 3; b < 17; b += 2) {
+					seed = seed * 1103515245 + 12345;
+					if (seed >> 16 & 1) {
+						c->SetLEDPressYellow(b);
+					}
+					else {
+						c->SetLEDOff(b);
+					}
+				}
+			}
+			if (step % 250 == 5) {
+				warnOn = !warnOn;
+				if (warnOn) {
+					c->SetLEDPressRed(Warning);
+				}
+				else {
+					c->SetLEDOff(Warning);
+				}
+				warnTime = x52p_now_ns();
+			}
+			c->PumpOutputs();
+			if (warnTime >= 0 && standin[0].leds[Warning] == warnOn) {	// On the device: the latency, step resolution
+				long long latency = x52p_now_ns() - warnTime;
+				worst = (latency > worst) ? latency : worst;
+				sum += latency;
+				++warnings;
+				warnTime = -1;
+			}
+			next += 1000000;
+			X52SleepUntil(next, timer, SamplerSpinNs);
+		}
+		c->GetOutputStats(&after);
+		printf("  budget %3.0f/s: %5lld calls for %llu writes, %llu coalesced, %llu deferred, %d pending,"
+			" warning latency mean %.2f ms worst %.2f ms\n", rate, standinWrites - calls, after.submitted - before.submitted,
+			after.coalesced - before.coalesced, after.deferred - before.deferred, after.pending,
+			(warnings > 0) ? sum * 1e-6 / warnings : 0.0, worst * 1e-6);
+		delete c;
+	}
+	if (timer != NULL) {
+		CloseHandle(timer);
+	}
+}
+
+//////////////////////////// MAIN /////////////////////////////////////////
+struct Bench {
+	const char* name;
+	void (*run)();
+};
+
+const Bench benches[] = {
+	{ "mfd", BenchMFD },
+	{ "map", BenchMap },
+	{ "state", BenchState },
+	{ "subs", BenchSubs },
+#ifdef X52P_BENCH_ASYNC
+	{ "async", BenchAsync },
+#endif
+	{ "event", BenchEvent },
+	{ "output", BenchOutput },
+};
+const int BenchCount = sizeof(benches) / sizeof(benches[0]);
+
+int main(int argc, char** argv) {
+	for (int a = 1; a < argc; ++a) {
+		int b = 0;
+		while (b < BenchCount && strcmp(argv[a], benches[b].name) != 0) {
+			++b;
+		}
+		if (b == BenchCount) {
+			printf("Usage: x52p_bench [name ...], names:");
+			for (b = 0; b < BenchCount; ++b) {
+				printf(" %s", benches[b].name);
+			}
+			printf("\n");
+			return 1;
+		}
+	}
+	for (int b = 0; b < BenchCount; ++b) {
+		int run = (argc == 1);
+		for (int a = 1; a < argc; ++a) {
+			run |= (strcmp(argv[a], benches[b].name) == 0);
+		}
+		if (run) {
+			benches[b].run();
+		}
+	}
+	return 0;
+}
@@ -1,352 +1,3495 @@
-// ---------------------------------------------------------------------------------------------------------- //
-// Osaka University: Dimas M. Rachman, 2022.
-// Functions definitions file. Requires x52p_ctrl.h header!
-// This file is not a main file (implementation), you need to make your own implementation file!
-// Nevertheless, a sample is provided, namely TESTWORKX52P.cpp.
-// Saitek/Logitech x52 pro HOTAS.
-
-// REQUIREMENTS
-// A.	Make sure you have installed DirectX SDK https://www.microsoft.com/en-us/download/details.aspx?id=6812.
-//		This SDK providess the necessary headers like dinput.h and libraries like dinput8.lib, dxguid.lib.
-
-// B.	Download the DirectOutput API (.lib, .h, and .dll) https://1drv.ms/u/s!Aq8Kg0iqxkdrgfxXZBc5CL-a9-SAaQ.
-//		See https://forums.frontier.co.uk/threads/how-to-use-x52-pro-sdk-making-us-of-the-mfd-and-leds.428813/.
-//		Put the DirectOutput.lib, DirectOutput.h, and DirectOutput.dll in your folder.
-
-// C.	Necessary files to be in your folder (where your .slx present, or the referenced path):
-//			1. DirectOutput.lib, DirectOutput.h, and DirectOutput.dll
-//			   (Put the DirectOuput.dll in the folder where your .exe presents)
-//			2. x52p_ctrl.h the header file
-//			3. x52p_ctrl.cpp the function definition file: this file
-//			4. Your .cpp impelementation file (put it in Source Files)
-
-// HOW TO COMPILE IN VISUAL STUDIO
-// Include the x52p_ctrl.h in the header files (project tree) and in your folder.
-// When something goes wrong, you can manually set everything in the project properties.
-//	1. In the C/C++ -> General -> Additional Include Directories, add the "Include" folder of the DirectX SDK.
-//	   (Find the folder in your DirectX SDK installation directory).
-//  2. In the Linker -> General -> Additional Library Directories, add the "Lib/x64" (if win64) of the
-//	   DirectX SDK (find it in your DirectX SDK installation directory).
-//	3. In the Linker -> Input -> Additional Dependencies, write DirectOutput.lib; dinput8.lib; dxguid.lib, add.
-// ---------------------------------------------------------------------------------------------------------- //
-
-
-#include "x52p_ctrl.h"				// External dependency file, header file
-
-x52p_ctrl::x52p_ctrl() {			// To instantiate a Class object, default
-	joystick_id = 0;	// Default set joystick ID as 0
-	InitDev();			// Initialize DirectInput
-	GetCaps();			// Get caps
-	DirectOutputInit();	// Initialize DirectOutput
-}
-
-x52p_ctrl::x52p_ctrl(int id) {		// To instantiate a Class object
-	joystick_id = id;	// Set manual joystick ID 
-	InitDev();			// Initialize DirectInput
-	GetCaps();			// Get caps
-	DirectOutputInit();	// Initialize DirectOutput
-}
-
-// Callback for EnumDevices method (function in a Class) https://learn.microsoft.com/en-us/previous-versions/windows/desktop/ee416622(v=vs.85)
-BOOL CALLBACK DirectEnumCB(LPCDIDEVICEINSTANCE instance, LPVOID context) {
-	Joysticks* joysticks = (Joysticks*)context; // Assign a pointer for something with Joysticks struct pointer, name it joysticks
-
-	IDirectInputDevice8* x52pd;		// Create a pointer for the interface of selected device, name it x52pd
-
-	// Method to create and initialize an instance of a device, obtain a device interface 
-	// https://learn.microsoft.com/en-us/previous-versions/windows/desktop/ee417803(v=vs.85)
-	joysticks->x52p_inps->CreateDevice(instance->guidInstance, &x52pd, NULL); // Put it in the pointer of x52p_inps (input interface)
-
-	// Method to set coop level, BG access: device can be acquired at any time
-	// NONEXCLUSIVE: access to device does not interefere with others who are accessing the same device
-	// https://learn.microsoft.com/en-us/previous-versions/windows/desktop/ee417921(v=vs.85)
-	x52pd->SetCooperativeLevel(GetActiveWindow(), DISCL_BACKGROUND | DISCL_EXCLUSIVE); // Access selected device interface via pointer
-
-	// Method to set the format to a joystick (not keyboard etc.) https://learn.microsoft.com/en-us/previous-versions/windows/desktop/ee417925(v=vs.85)
-	x52pd->SetDataFormat(&c_dfDIJoystick2); // Access selected device interface via pointer
-
-	// Method to gain access to the device, AFTER SetDataFormat
-	// https://learn.microsoft.com/en-us/previous-versions/windows/desktop/ee417818(v=vs.85)
-	x52pd->Acquire(); // Access selected device interface via pointer
-
-	// Update deviceCount by accessing the elements of a struct via pointer 
-	joysticks->deviceCount += 1;
-
-	// Since we do assume there will be many devices, then realloc the pointer to pointer (device interface)
-	joysticks->x52p_devs = (IDirectInputDevice8**)realloc(joysticks->x52p_devs, joysticks->deviceCount * sizeof(IDirectInputDevice8*));
-
-	// Assign the pointer to pointer of the device with that of the selected device interface
-	joysticks->x52p_devs[joysticks->deviceCount - 1] = x52pd;
-
-	// To continue enumeration, if you want to stop use DIENUM_STOP
-	// return DIENUM_CONTINUE;
-	// ONLY ONE DEVICE
-	return DIENUM_CONTINUE;
-}
-
-// Initialize and create device, do it just once
-Joysticks x52p_ctrl::InitDev() {
-	thejoys = { 0 }; // initialization of the struct, namely joysticks with Joysticks struct
-
-	// Creates a DirectInput object https://learn.microsoft.com/en-us/previous-versions/windows/desktop/ee416756(v=vs.85)
-	DirectInput8Create(hInstance, DIRECTINPUT_VERSION, IID_IDirectInput8, (void**)&thejoys.x52p_inps, 0);
-
-	// Arrow operator -> allows access elements in a struct via pointer that points to a struct.
-	// Similar to dot but dot access elements in a struct directly.
-	// Enumerat all devices https://learn.microsoft.com/en-us/previous-versions/windows/desktop/ee417804(v=vs.85)
-	thejoys.x52p_inps->EnumDevices(DI8DEVCLASS_GAMECTRL, DirectEnumCB, (void*)&thejoys, DIEDFL_ALLDEVICES);
-
-	return thejoys;
-}
-
-// Get device capabilities
-DIDEVCAPS x52p_ctrl::GetCaps() {
-	// Describes the DirectInput devices capabiliteis, DIDEVCAPS is a structure
-	// https://learn.microsoft.com/en-us/previous-versions/windows/desktop/ee416607(v=vs.85)
-	caps = { sizeof(DIDEVCAPS) }; // Allocate memory
-
-	// Get the capabilities of the device object
-	// https://learn.microsoft.com/en-us/previous-versions/windows/desktop/ee417892(v=vs.85)
-	thejoys.x52p_devs[joystick_id]->GetCapabilities(&caps); // Put it in the memory address of caps with DIDEVCAPS struct
-
-	return caps;
-}
-
-// Get button number from caps
-int x52p_ctrl::GetButtonNum() {
-	return caps.dwButtons;
-}
-
-// Get the state from the device, do it every step
-DIJOYSTATE2 x52p_ctrl::GetState() {
-	// Method to get the state of the device
-	// Puts the state in the memory addres of state with DIJOYSTATE struct returns a DI_OK
-	// Must create, set cooperative level, data format, and acquire, in that order
-	// https://learn.microsoft.com/en-us/previous-versions/windows/desktop/ee417897(v=vs.85)
-	// ONLY ONE DEVICE
-	ZeroMemory(&state, sizeof(DIJOYSTATE2));    //Set Memory to 0
-	thejoys.x52p_devs[joystick_id]->GetDeviceState(sizeof(state), &state);
-
-	return state;
-}
-
-// Check device exists or not
-int x52p_ctrl::IsDevConnected() {
-	HRESULT hr = thejoys.x52p_devs[joystick_id]->GetDeviceState(sizeof(state), &state);
-	if (hr == DI_OK) {
-		return 1;
-	}
-	else {
-		return 0;
-	}
-}
-
-// Get joystick ID
-int x52p_ctrl::GetDevID() {
-	return joystick_id;
-}
-
-// Unacquire the device
-void x52p_ctrl::UnacqDev() {
-	HRESULT hr;
-	hr = thejoys.x52p_devs[joystick_id]->Unacquire();
-	//if (hr == DI_OK) {
-	//	std::cout << "Unacquiring success";
-	//}
-}
-
-////////////////////////////  AXES ///////////////////////////////////////
-double x52p_ctrl::XJoy() {
-	if (state.lX > thrs + deadzone || state.lX < thrs - deadzone) {
-		return (state.lX - thrs) / thrs;
-	}
-	else {
-		return 0.0f;
-	}
-}
-
-double x52p_ctrl::YJoy() {
-	if (state.lY > thrs + deadzone || state.lY < thrs - deadzone) {
-		return((thrs - state.lY) / thrs);
-	}
-	else {
-		return 0.0f;
-	}
-}
-
-double x52p_ctrl::ZJoy() {
-	// Modified correctly, Jan 2023
-	double tmpZ = thrsZ - state.lZ; // Set to 0 to thrsZ
-	
-	if (tmpZ > deadzone) {
-		return(tmpZ / thrsZ);
-	}
-	else {
-		return 0.0f;
-	}
-}
-
-double x52p_ctrl::RXJoy() {
-	return(state.lRx / thrsZ);
-}
-
-double x52p_ctrl::RYJoy() {
-	return(state.lRy / thrsZ);
-}
-
-double x52p_ctrl::RZJoy() {
-	if (state.lRz > thrs + deadzone || state.lRz < thrs - deadzone) {
-		return((state.lRz - thrs) / thrs);
-	}
-	else {
-		return 0.0f;
-	}
-}
-
-//////////////////////////// SLIDERS //////////////////////////////////////
-double x52p_ctrl::slid() {
-	return state.rglSlider[0] / thrsZ;	// Slider on the throttle/clutch
-}
-
-//////////////////////////// AIMPOV ///////////////////////////////////////
-int x52p_ctrl::povdeg() {
-	int pov = state.rgdwPOV[0] / 100;	// Return the aim at every 45 deg.
-	if (state.rgdwPOV[0] == -1) {
-		pov = -1000;	// When not used, it gives -1000.
-	}
-	return pov;
-}
-
-//////////////////////////// BUTTONS //////////////////////////////////////
-int x52p_ctrl::IsButtonPressed(int button_id) {
-	if (state.rgbButtons[button_id]) {
-		return 1;	// If button pressed returns 1 as integer
-	}
-	else {
-		return 0;	
-	}
-}
-
-
-//////////////////////////// DIRECTOUTPUT /////////////////////////////////
-// Callback to register the devices
-void __stdcall DirectOutput_Device_Callback(void* hDevice, bool bAdded, void* pvContext) {
-	if (bAdded) {
-		DOdevs.push_back(hDevice);
-	}
-	else {
-	}
-}
-
-// Callback to enumerate the devices
-void __stdcall DirectOutput_Enumerate_Callback(void* hDevice, void* pvContext) {
-	DOdevs.push_back(hDevice);
-}
-
-// Method to initialize the DirectOutput
-void x52p_ctrl::DirectOutputInit() {
-	DirectOutput_Initialize(name);	// Initialize the DirectOutput
-	DirectOutput_RegisterDeviceCallback(*DirectOutput_Device_Callback, nullptr);	// Register the devices
-	DirectOutput_Enumerate(*DirectOutput_Enumerate_Callback, nullptr);				// Enumerate the devices
-
-	DirectOutput_AddPage(DOdevs[joystick_id], dwPage, pageDebugName, FLAG_SET_AS_ACTIVE);	// AddPage for the device, activate
-
-	SetAllLEDGreen();	// Set all LEDS on
-	SetAllLEDOff();		// Set most of the LEDs off
-
-	// Set welcome text
-	text = L"MAKI ATSUO";
-	length = wcslen(text);
-	SetMDFText(text, length, 0);
-}
-
-// Method to put text in the MDF DirectOutput, id is the id, use 0 for one device. This is predefined
-void x52p_ctrl::SetMDFTextAuto(int autoflg, int VecTflg) {
-	if (autoflg == 1) {
-		text = L"AUTO MODE";
-		length = wcslen(text);
-		DirectOutput_SetString(DOdevs[joystick_id], dwPage, 2, length, text);
-		SetLEDPressGreen(17);	// Set LED on the clutch to green
-	}
-	else {
-		text = L"MANUAL MODE";
-		length = wcslen(text);
-		DirectOutput_SetString(DOdevs[joystick_id], dwPage, 2, length, text);
-		DirectOutput_SetLed(DOdevs[joystick_id], dwPage, 17, 0); // Turn of the LED on the clutch
-	}
-
-	if (VecTflg == 1) {
-		text = L"VECTWIN ON";
-		length = wcslen(text);
-		DirectOutput_SetString(DOdevs[joystick_id], dwPage, 1, length, text);
-	}
-	else {
-		text = L"PARALLEL ON";
-		length = wcslen(text);
-		DirectOutput_SetString(DOdevs[joystick_id], dwPage, 1, length, text);
-	}
-}
-
-// Method to put text in the MDF DirectOutput, id is the id, use 0 for one device. This is free
-void x52p_ctrl::SetMDFText(const wchar_t* text, DWORD length, DWORD pos) {
-	DirectOutput_SetString(DOdevs[joystick_id], dwPage, pos, length, text);
-}
-
-// Method to put text in the landing page
-void x52p_ctrl::SetMDFLanding() {
-	text = L"ATSUO MAKI";
-	length = wcslen(text);
-	SetMDFText(text, length, 0);
-}
-
-// Method to change LED in the DirectOuput: green, red, and yellow only, and off
-void x52p_ctrl::SetLEDPressYellow(DWORD b_id) {
-	DirectOutput_SetLed(DOdevs[joystick_id], dwPage, b_id, 1);
-	DirectOutput_SetLed(DOdevs[joystick_id], dwPage, b_id + 1, 1);
-}
-
-void x52p_ctrl::SetLEDPressRed(DWORD b_id) {
-	DirectOutput_SetLed(DOdevs[joystick_id], dwPage, b_id, 1);
-}
-
-void x52p_ctrl::SetLEDPressGreen(DWORD b_id) {
-	DirectOutput_SetLed(DOdevs[joystick_id], dwPage, b_id + 1, 1);
-}
-
-void x52p_ctrl::SetLEDOff(DWORD b_id) {
-	if (b_id == 0) {
-		//DirectOutput_SetLed(DOdevs[joystick_id], dwPage, b_id, 1);
-		return;
-	}
-	else if (b_id > 16 && b_id < 20) {
-		return;
-	}
-	else {
-		DirectOutput_SetLed(DOdevs[joystick_id], dwPage, b_id, 0);
-		DirectOutput_SetLed(DOdevs[joystick_id], dwPage, b_id + 1, 0);
-	}
-		
-}
-
-void x52p_ctrl::SetAllLEDGreen() {
-	int i;
-	for (i = 1; i < 19; ++i) {
-		if (i % 2 == 0 && i != 0) {
-			DirectOutput_SetLed(DOdevs[joystick_id], dwPage, i, 1); // All except the fire button and throttle
-		}
-	}
-}
-
-void x52p_ctrl::SetAllLEDOff() {
-	int i;
-	for (i = 0; i < 19; ++i) {
-		if (i % 2 == 0 && i != 0) {
-			DirectOutput_SetLed(DOdevs[joystick_id], dwPage, i, 0); // All except the fire button and throttle
-		}
-	}
-}
-
-// Method to stop the DirectOutput
-void x52p_ctrl::DirectOutputStop() {
-	DirectOutput_Deinitialize();
-}
\ No newline at end of file
+// ---------------------------------------------------------------------------------------------------------- //
+// Osaka University: Dimas M. Rachman, 2022.
+// Functions definitions file. Requires x52p_ctrl.h header!
+// This file is not a main file (implementation), you need to make your own implementation file!
+// Nevertheless, a sample is provided, namely TESTWORKX52P.cpp.
+// Saitek/Logitech x52 pro HOTAS.
+
+// REQUIREMENTS
+// A.	Make sure you have installed DirectX SDK https://www.microsoft.com/en-us/download/details.aspx?id=6812.
+//		This SDK providess the necessary headers like dinput.h and libraries like dinput8.lib, dxguid.lib.
+
+// B.	Download the DirectOutput API (.lib, .h, and .dll) https://1drv.ms/u/s!Aq8Kg0iqxkdrgfxXZBc5CL-a9-SAaQ.
+//		See https://forums.frontier.co.uk/threads/how-to-use-x52-pro-sdk-making-us-of-the-mfd-and-leds.428813/.
+//		Put the DirectOutput.lib, DirectOutput.h, and DirectOutput.dll in your folder.
+
+// C.	Necessary files to be in your folder (where your .slx present, or the referenced path):
+//			1. DirectOutput.lib, DirectOutput.h, and DirectOutput.dll
+//			   (Put the DirectOuput.dll in the folder where your .exe presents)
+//			2. x52p_ctrl.h the header file
+//			3. x52p_ctrl.cpp the function definition file: this file
+//			4. Your .cpp impelementation file (put it in Source Files)
+
+// HOW TO COMPILE IN VISUAL STUDIO
+// Include the x52p_ctrl.h in the header files (project tree) and in your folder.
+// When something goes wrong, you can manually set everything in the project properties.
+//	1. In the C/C++ -> General -> Additional Include Directories, add the "Include" folder of the DirectX SDK.
+//	   (Find the folder in your DirectX SDK installation directory).
+//  2. In the Linker -> General -> Additional Library Directories, add the "Lib/x64" (if win64) of the
+//	   DirectX SDK (find it in your DirectX SDK installation directory).
+//	3. In the Linker -> Input -> Additional Dependencies, write DirectOutput.lib; dinput8.lib; dxguid.lib, add.
+// ---------------------------------------------------------------------------------------------------------- //
+
+
+#include "x52p_ctrl.h"				// External dependency file, header file
+
+x52p_ctrl::x52p_ctrl() {			// To instantiate a Class object, default
+	joystick_id = 0;	// Default set joystick ID as 0
+	InitDev();			// Initialize DirectInput
+	GetCaps();			// Get caps
+	DirectOutputInit();	// Initialize DirectOutput
+}
+
+x52p_ctrl::x52p_ctrl(int id) {		// To instantiate a Class object
+	joystick_id = id;	// Set manual joystick ID 
+	InitDev();			// Initialize DirectInput
+	GetCaps();			// Get caps
+	DirectOutputInit();	// Initialize DirectOutput
+}
+
+x52p_ctrl::x52p_ctrl(int id, int mode) {	// To instantiate a Class object, DirectInput only if shared
+	joystick_id = id;
+	diShared = (mode == OPEN_INPUT_SHARED);
+	InitDev();			// Initialize DirectInput, or take the shared one
+	GetCaps();
+	if (!diShared) {
+		DirectOutputInit();	// No MFD and LEDs for a shared object
+	}
+}
+
+// DirectInput and devices of the OPEN_INPUT_SHARED objects, made by the first one, released by the last one
+static Joysticks DIshared = { 0 };
+static int DIsharedUsers = 0;
+static std::mutex DIsharedLock;
+
+x52p_ctrl::~x52p_ctrl() {			// Destructor, called by delete: leave DirectOutput and release DirectInput
+	DirectOutputStop();
+	ReleaseDev();
+	StopConfigWatch();
+	std::lock_guard<std::mutex> lock(cfgLock);
+	FreeRetiredConfigs(1);
+	const X52Config* last = cfg.exchange(X52DefaultConfig());
+	if (last != X52DefaultConfig()) {
+		delete last;
+	}
+}
+
+// Callback for EnumDevices method (function in a Class) https://learn.microsoft.com/en-us/previous-versions/windows/desktop/ee416622(v=vs.85)
+BOOL CALLBACK DirectEnumCB(LPCDIDEVICEINSTANCE instance, LPVOID context) {
+	Joysticks* joysticks = (Joysticks*)context; // Assign a pointer for something with Joysticks struct pointer, name it joysticks
+
+	IDirectInputDevice8* x52pd;		// Create a pointer for the interface of selected device, name it x52pd
+
+	// Method to create and initialize an instance of a device, obtain a device interface 
+	// https://learn.microsoft.com/en-us/previous-versions/windows/desktop/ee417803(v=vs.85)
+	if (joysticks->x52p_inps->CreateDevice(instance->guidInstance, &x52pd, NULL) != DI_OK) { // Put it in the pointer of x52p_inps (input interface)
+		return DIENUM_CONTINUE;	// Skip a device that cannot be opened
+	}
+
+	// Method to set coop level, BG access: device can be acquired at any time
+	// NONEXCLUSIVE: access to device does not interefere with others who are accessing the same device
+	// (e.g. another x52p_ctrl object reading another device, every object enumerates all the devices)
+	// https://learn.microsoft.com/en-us/previous-versions/windows/desktop/ee417921(v=vs.85)
+	x52pd->SetCooperativeLevel(GetActiveWindow(), DISCL_BACKGROUND | DISCL_NONEXCLUSIVE); // Access selected device interface via pointer
+
+	// Method to set the format to a joystick (not keyboard etc.) https://learn.microsoft.com/en-us/previous-versions/windows/desktop/ee417925(v=vs.85)
+	x52pd->SetDataFormat(&c_dfDIJoystick2); // Access selected device interface via pointer
+
+	// Method to gain access to the device, AFTER SetDataFormat
+	// https://learn.microsoft.com/en-us/previous-versions/windows/desktop/ee417818(v=vs.85)
+	x52pd->Acquire(); // Access selected device interface via pointer
+
+	// Update deviceCount by accessing the elements of a struct via pointer 
+	joysticks->deviceCount += 1;
+
+	// Since we do assume there will be many devices, then realloc the pointer to pointer (device interface)
+	// Freed in ReleaseDev()
+	IDirectInputDevice8** devs = (IDirectInputDevice8**)realloc(joysticks->x52p_devs, joysticks->deviceCount * sizeof(IDirectInputDevice8*));
+	if (devs == NULL) {
+		joysticks->deviceCount -= 1;
+		x52pd->Release();
+		return DIENUM_STOP;
+	}
+	joysticks->x52p_devs = devs;
+
+	// Assign the pointer to pointer of the device with that of the selected device interface
+	joysticks->x52p_devs[joysticks->deviceCount - 1] = x52pd;
+
+	// To continue enumeration, if you want to stop use DIENUM_STOP
+	// return DIENUM_CONTINUE;
+	// ONLY ONE DEVICE
+	return DIENUM_CONTINUE;
+}
+
+// Create DirectInput and enumerate the devices into joys, 0 if there is no DirectInput
+static int OpenDirectInput(Joysticks* joys) {
+	HINSTANCE hInstance = GetModuleHandle(NULL); // Instance of the window, null is fine
+
+	// Creates a DirectInput object https://learn.microsoft.com/en-us/previous-versions/windows/desktop/ee416756(v=vs.85)
+	if (DirectInput8Create(hInstance, DIRECTINPUT_VERSION, IID_IDirectInput8, (void**)&joys->x52p_inps, 0) != DI_OK) {
+		joys->x52p_inps = NULL;
+		return 0;	// No DirectInput, no devices
+	}
+
+	// Arrow operator -> allows access elements in a struct via pointer that points to a struct.
+	// Similar to dot but dot access elements in a struct directly.
+	// Enumerat all devices https://learn.microsoft.com/en-us/previous-versions/windows/desktop/ee417804(v=vs.85)
+	joys->x52p_inps->EnumDevices(DI8DEVCLASS_GAMECTRL, DirectEnumCB, (void*)joys, DIEDFL_ALLDEVICES);
+	return 1;
+}
+
+// Release the devices and DirectInput of joys and free the device array, joys is empty after
+static void CloseDirectInput(Joysticks* joys) {
+	for (unsigned int i = 0; i < joys->deviceCount; ++i) {
+		joys->x52p_devs[i]->Unacquire();
+		joys->x52p_devs[i]->Release();
+	}
+	free(joys->x52p_devs);
+	if (joys->x52p_inps != NULL) {
+		joys->x52p_inps->Release();
+	}
+	*joys = { 0 };
+}
+
+// Initialize and create device, do it just once
+// Shared (OPEN_INPUT_SHARED): the first object opens DirectInput for all, the others copy it
+Joysticks x52p_ctrl::InitDev() {
+	ReleaseDev();		// Nothing is kept from a previous InitDev()
+	ZeroMemory(&diInstance, sizeof(GUID));
+	if (diShared) {
+		std::lock_guard<std::mutex> lock(DIsharedLock);
+		if (DIsharedUsers == 0 && !OpenDirectInput(&DIshared)) {
+			return thejoys;
+		}
+		++DIsharedUsers;
+		thejoys = DIshared;
+	}
+	else if (!OpenDirectInput(&thejoys)) {
+		return thejoys;
+	}
+
+	// Keep the instance GUID of our device, DirectOutput reports the same GUID for the same device
+	if (joystick_id < (int)thejoys.deviceCount) {
+		DIDEVICEINSTANCE info = { sizeof(DIDEVICEINSTANCE) };
+		if (thejoys.x52p_devs[joystick_id]->GetDeviceInfo(&info) == DI_OK) {
+			diInstance = info.guidInstance;
+		}
+	}
+
+	return thejoys;
+}
+
+// Release all the devices and DirectInput (COM references) and free the device array
+// Safe to call again, InitDev() can be called after it. Shared: the last object releases them
+void x52p_ctrl::ReleaseDev() {
+	StopSampler();		// Reads the device
+	if (inEvent != NULL) {
+		if (joystick_id < (int)thejoys.deviceCount) {
+			thejoys.x52p_devs[joystick_id]->Unacquire();
+			thejoys.x52p_devs[joystick_id]->SetEventNotification(NULL);
+		}
+		CloseHandle(inEvent);
+		inEvent = NULL;
+	}
+	if (!diShared) {
+		CloseDirectInput(&thejoys);
+		return;
+	}
+	std::lock_guard<std::mutex> lock(DIsharedLock);
+	if (thejoys.x52p_inps != NULL && --DIsharedUsers == 0) {
+		CloseDirectInput(&DIshared);
+	}
+	thejoys = { 0 };
+}
+
+// Get device capabilities
+DIDEVCAPS x52p_ctrl::GetCaps() {
+	// Describes the DirectInput devices capabiliteis, DIDEVCAPS is a structure
+	// https://learn.microsoft.com/en-us/previous-versions/windows/desktop/ee416607(v=vs.85)
+	caps = { sizeof(DIDEVCAPS) }; // Allocate memory
+	if (joystick_id >= (int)thejoys.deviceCount) {
+		return caps;	// No such device, see GetDevCount()
+	}
+
+	// Get the capabilities of the device object
+	// https://learn.microsoft.com/en-us/previous-versions/windows/desktop/ee417892(v=vs.85)
+	thejoys.x52p_devs[joystick_id]->GetCapabilities(&caps); // Put it in the memory address of caps with DIDEVCAPS struct
+
+	return caps;
+}
+
+// Get button number from caps
+int x52p_ctrl::GetButtonNum() {
+	return caps.dwButtons;
+}
+
+// Get the number of game controllers found, the joystick ID must be less than this
+int x52p_ctrl::GetDevCount() {
+	return thejoys.deviceCount;
+}
+
+// Get the state from the device, do it every step
+const DIJOYSTATE2& x52p_ctrl::GetState() {
+	return ReadState(CFG_READER_STEP);
+}
+
+// The same from the thread of reader (X52ConfigReader), e.g. a reading thread of x52p_fusion
+const DIJOYSTATE2& x52p_ctrl::ReadState(int reader) {
+	// Method to get the state of the device
+	// Puts the state in the memory addres of state with DIJOYSTATE struct returns a DI_OK
+	// Must create, set cooperative level, data format, and acquire, in that order
+	// https://learn.microsoft.com/en-us/previous-versions/windows/desktop/ee417897(v=vs.85)
+	// ONLY ONE DEVICE
+	X52P_TRACE_SCOPE("GetState");
+	PassConfig(reader);	// No old table in use here
+	HRESULT hr = E_HANDLE;	// No device with this ID
+	if (scenario != NULL) {	// Scripted input, the device is not read
+		X52State sampled;
+		scenario->Sample(simTime, &sampled);
+		hr = (scenario->GetFault() == WAVE_ERROR) ? DIERR_INPUTLOST : DI_OK;
+		cstate = (scenario->GetFault() == 0) ? sampled : wdLastGood;	// Frozen: the last state read again
+		X52StateToDI(&cstate, &state);
+		stateTime = (long long)(simTime * 1e9);
+	}
+	else {
+		ZeroMemory(&state, sizeof(DIJOYSTATE2));    //Set Memory to 0
+		if (joystick_id < (int)thejoys.deviceCount) {
+			X52P_TRACE_SCOPE("GetDeviceState");
+			hr = thejoys.x52p_devs[joystick_id]->GetDeviceState(sizeof(state), &state);
+		}
+		X52StateFromDI(&state, &cstate);	// What the other methods read
+		stateTime = x52p_now_ns();
+	}
+	Watchdog(hr, stateTime);	// Replaces cstate and state by the last good or the failsafe one if needed
+
+	return state;
+}
+
+// Get the compact state of the last GetState()
+const X52State& x52p_ctrl::GetCompactState() {
+	return cstate;
+}
+
+// Poll only when the device can have new data, for simulations faster than real time
+// minPeriod: wall-clock seconds between two polls at least, everyN: poll every N calls of Poll() at most.
+// Both apply, (0, 1) polls at every call (default). The clock is read every N calls only, so a poll can be up to
+// N calls late: with a step of 1 us, (0.001, 64) reads the clock once per 64 steps and polls about every ms.
+void x52p_ctrl::SetPollDecimation(double minPeriod, int everyN) {
+	pollPeriodNs = (minPeriod > 0) ? (long long)(minPeriod * 1e9) : 0;
+	pollEvery = (everyN > 1) ? everyN : 1;
+	pollSkip = pollEvery;	// The next call polls
+	pollLast = -(1LL << 62);
+	pollWindow = x52p_now_ns();
+	pollCount = 0;
+	pollRate = 0;
+}
+
+// Method to call every step instead of GetState(): returns 1 if the state was read, 0 if the last one is kept
+// Between the polls the axes, buttons, and POV methods give the values of the last poll.
+int x52p_ctrl::Poll() {
+	if (++pollSkip < pollEvery) {
+		return 0;	// Counter only, no clock
+	}
+	pollSkip = 0;	// The clock is read every N calls only
+	long long now = x52p_now_ns();
+	if (now - pollLast < pollPeriodNs) {
+		return 0;
+	}
+	pollLast = now;
+	GetState();
+
+	++pollCount;	// Effective rate, over windows of one second
+	if (now - pollWindow >= 1000000000LL) {
+		pollRate = pollCount * 1e9 / double(now - pollWindow);
+		pollCount = 0;
+		pollWindow = now;
+	}
+	return 1;
+}
+
+// Polls per second (wall clock) of Poll(), updated every second
+double x52p_ctrl::GetPollRate() {
+	return pollRate;
+}
+
+// All the normalized axes with the configuration, in the order of X52State::axes
+void x52p_ctrl::GetAxes(double axes[AxisCount]) {
+	NormalizeAxes(&cstate, axes);
+}
+
+void x52p_ctrl::NormalizeAxes(const X52State* s, double axes[AxisCount]) {
+	const X52Config* c = cfg.load(std::memory_order_acquire);
+	for (int i = 0; i < AxisCount; ++i) {
+		axes[i] = X52ConfigAxis(c, s, i);
+	}
+}
+
+// Time of the last GetState() in ns: x52p_now_ns(), or the simulation time with a scenario
+long long x52p_ctrl::GetStateTime() {
+	return stateTime;
+}
+
+// Use a scenario instead of the device from the next GetState(), NULL for the device again
+// The scenario is not owned, it must stay until SetScenario(NULL) or the delete of this object
+void x52p_ctrl::SetScenario(x52p_scenario* source) {
+	scenario = source;
+	wdGoodTime = wdFreshTime = WatchdogNever;	// Other clock (simulation time)
+}
+
+// Time (s) at which GetState() samples the scenario, e.g. the simulation time
+void x52p_ctrl::SetSimTime(double t) {
+	simTime = t;
+}
+
+// Check device exists or not
+int x52p_ctrl::IsDevConnected() {
+	if (joystick_id >= (int)thejoys.deviceCount) {
+		return 0;
+	}
+	HRESULT hr = thejoys.x52p_devs[joystick_id]->GetDeviceState(sizeof(state), &state);
+	if (hr == DI_OK) {
+		return 1;
+	}
+	else {
+		return 0;
+	}
+}
+
+// Get joystick ID
+int x52p_ctrl::GetDevID() {
+	return joystick_id;
+}
+
+// Unacquire the device
+void x52p_ctrl::UnacqDev() {
+	HRESULT hr;
+	if (diShared || joystick_id >= (int)thejoys.deviceCount) {
+		return;	// Shared: other objects may read the device, the last one unacquires it (ReleaseDev())
+	}
+	hr = thejoys.x52p_devs[joystick_id]->Unacquire();
+	//if (hr == DI_OK) {
+	//	std::cout << "Unacquiring success";
+	//}
+}
+
+////////////////////////////  AXES ///////////////////////////////////////
+// Normalized from the compact state with the configuration, see X52ConfigAxis()
+double x52p_ctrl::XJoy() {
+	return X52ConfigAxis(cfg.load(std::memory_order_acquire), &cstate, 0);
+}
+
+double x52p_ctrl::YJoy() {
+	return X52ConfigAxis(cfg.load(std::memory_order_acquire), &cstate, 1);
+}
+
+double x52p_ctrl::ZJoy() {
+	return X52ConfigAxis(cfg.load(std::memory_order_acquire), &cstate, 2);
+}
+
+double x52p_ctrl::RXJoy() {
+	return X52ConfigAxis(cfg.load(std::memory_order_acquire), &cstate, 3);
+}
+
+double x52p_ctrl::RYJoy() {
+	return X52ConfigAxis(cfg.load(std::memory_order_acquire), &cstate, 4);
+}
+
+double x52p_ctrl::RZJoy() {
+	return X52ConfigAxis(cfg.load(std::memory_order_acquire), &cstate, 5);
+}
+
+//////////////////////////// SLIDERS //////////////////////////////////////
+double x52p_ctrl::slid() {
+	return X52ConfigAxis(cfg.load(std::memory_order_acquire), &cstate, 6);	// Slider on the throttle/clutch
+}
+
+//////////////////////////// AIMPOV ///////////////////////////////////////
+int x52p_ctrl::povdeg() {
+	return X52PovDeg(&cstate);	// Return the aim at every 45 deg, -1000 when not used
+}
+
+//////////////////////////// BUTTONS //////////////////////////////////////
+int x52p_ctrl::IsButtonPressed(int button_id) {
+	if (button_id >= 0 && button_id < ButtonCount && (cstate.buttons >> button_id & 1)) {
+		return 1;	// If button pressed returns 1 as integer
+	}
+	else {
+		return 0;	
+	}
+}
+
+// All the buttons as bits, bit i is button i (0 to 38), for comparing and masks
+unsigned long long x52p_ctrl::GetButtonMask() {
+	return cstate.buttons;
+}
+
+//////////////////////////// COMPACT STATE ////////////////////////////////
+// X52State keeps what the x52 pro uses of DIJOYSTATE2. The conversions use SSE2 (always there on x64):
+// the seven axes are contiguous LONGs (lX to rglSlider[0]) packed to 16 bits, the buttons are the high
+// bit of each rgbButtons byte, taken sixteen at a time with movemask.
+
+// Convert the DirectInput state to the compact state
+void X52StateFromDI(const DIJOYSTATE2* in, X52State* out) {
+	// Axes: lX, lY, lZ, lRx, lRy, lRz, rglSlider[0] (and rglSlider[1], dropped), 0 to 65535
+	// packs is signed, so shift to -32768..32767 and back, which also clamps out of range values
+	const __m128i bias32 = _mm_set1_epi32(32768), bias16 = _mm_set1_epi16(-32768);
+	__m128i lo = _mm_sub_epi32(_mm_loadu_si128((const __m128i*)&in->lX), bias32);
+	__m128i hi = _mm_sub_epi32(_mm_loadu_si128((const __m128i*)&in->lRy), bias32);
+	__m128i axes = _mm_xor_si128(_mm_packs_epi32(lo, hi), bias16);
+	unsigned short tmp[8];
+	_mm_storeu_si128((__m128i*)tmp, axes);
+	memcpy(out->axes, tmp, sizeof(out->axes));
+
+	// Buttons: 48 bytes read (within the 128), the bits above button 38 are cut
+	const __m128i* b = (const __m128i*)in->rgbButtons;
+	unsigned long long m0 = (unsigned int)_mm_movemask_epi8(_mm_loadu_si128(b));
+	unsigned long long m1 = (unsigned int)_mm_movemask_epi8(_mm_loadu_si128(b + 1));
+	unsigned long long m2 = (unsigned int)_mm_movemask_epi8(_mm_loadu_si128(b + 2));
+	out->buttons = (m0 | m1 << 16 | m2 << 32) & X52ButtonBits;
+
+	// Hat: hundredths of degree, the low word is 0xFFFF when centered
+	DWORD pov = in->rgdwPOV[0];
+	out->hat = (LOWORD(pov) == 0xFFFF) ? X52HatCentered : (unsigned char)((pov % 36000 + 2250) / 4500 % 8);
+
+	unsigned int modes = (unsigned int)(out->buttons >> X52ModeButton) & 7;
+	out->mode = (modes & 1) ? 1 : (modes & 2) ? 2 : (modes & 4) ? 3 : 0;
+}
+
+// Convert back to a DirectInput state (e.g. to replay a log), the fields not kept are zero
+void X52StateToDI(const X52State* in, DIJOYSTATE2* out) {
+	ZeroMemory(out, sizeof(DIJOYSTATE2));
+	unsigned short tmp[8] = { 0 };
+	memcpy(tmp, in->axes, sizeof(in->axes));
+	__m128i axes = _mm_loadu_si128((const __m128i*)tmp);
+	_mm_storeu_si128((__m128i*)&out->lX, _mm_unpacklo_epi16(axes, _mm_setzero_si128()));	// Zero extend
+	__m128i hi = _mm_unpackhi_epi16(axes, _mm_setzero_si128());
+	out->lRy = _mm_cvtsi128_si32(hi);
+	out->lRz = _mm_cvtsi128_si32(_mm_srli_si128(hi, 4));
+	out->rglSlider[0] = _mm_cvtsi128_si32(_mm_srli_si128(hi, 8));
+
+	// Buttons: each byte of the mask copied to eight bytes, then each byte tests its own bit
+	const __m128i bits = _mm_set_epi8(-128, 64, 32, 16, 8, 4, 2, 1, -128, 64, 32, 16, 8, 4, 2, 1);
+	const __m128i pressed = _mm_set1_epi8(-128);
+	for (int i = 0; i < 3; ++i) {
+		__m128i v = _mm_cvtsi32_si128((int)(in->buttons >> (16 * i) & 0xFFFF));
+		v = _mm_unpacklo_epi8(v, v);
+		v = _mm_unpacklo_epi16(v, v);
+		v = _mm_unpacklo_epi32(v, v);
+		v = _mm_cmpeq_epi8(_mm_and_si128(v, bits), bits);
+		_mm_storeu_si128((__m128i*)out->rgbButtons + i, _mm_and_si128(v, pressed));
+	}
+
+	out->rgdwPOV[0] = (in->hat == X52HatCentered) ? 0xFFFFFFFF : in->hat * 4500;
+	out->rgdwPOV[1] = out->rgdwPOV[2] = out->rgdwPOV[3] = 0xFFFFFFFF;
+}
+
+// Which fields differ between two states, as bits (X52FieldHat, X52FieldMode, X52FieldButton0 + i)
+unsigned long long X52StateDiff(const X52State* a, const X52State* b) {
+	// One compare of the axes, hat and mode (16 bytes), one bit per 16-bit lane after packing
+	__m128i eq = _mm_cmpeq_epi16(_mm_loadu_si128((const __m128i*)a->axes), _mm_loadu_si128((const __m128i*)b->axes));
+	unsigned long long diff = ~(unsigned int)_mm_movemask_epi8(_mm_packs_epi16(eq, eq)) & 0x7F;
+	diff |= (unsigned long long)(a->hat != b->hat) << X52FieldHat;
+	diff |= (unsigned long long)(a->mode != b->mode) << X52FieldMode;
+	diff |= (a->buttons ^ b->buttons) << X52FieldButton0;
+	return diff;
+}
+
+// Normalized value of one axis with the built-in configuration:
+// X, Y, RZ -1 to 1 with a deadzone, Z 0 to 1 with a deadzone, RX, RY, slider 0 to 1
+double X52AxisValue(const X52State* s, int axis) {
+	return X52ConfigAxis(X52DefaultConfig(), s, axis);
+}
+
+// All the normalized axes, in the order of X52State::axes
+void X52Normalize(const X52State* s, double axes[AxisCount]) {
+	for (int i = 0; i < AxisCount; ++i) {
+		axes[i] = X52AxisValue(s, i);
+	}
+}
+
+// POV aim in degrees (every 45 deg), -1000 when not used
+int X52PovDeg(const X52State* s) {
+	return (s->hat == X52HatCentered) ? -1000 : s->hat * 45;
+}
+
+//////////////////////////// SAMPLER //////////////////////////////////////
+// A thread reads the device at a fixed rate (e.g. 1 kHz, more than the steps) into a ring of X52Sample,
+// the caller takes them every step with ReadSamples(). The ring is allocated by StartSampler() only and
+// holds capacity samples (rounded up to a power of two): when the caller falls behind by that much the
+// newest samples are dropped and counted. The sampler does not touch the state of GetState().
+
+// rate: samples per second, capacity: samples the ring holds (a few steps worth). Returns 0 without a device
+int x52p_ctrl::StartSampler(double rate, int capacity) {
+	StopSampler();
+	if (rate <= 0 || joystick_id >= (int)thejoys.deviceCount) {
+		return 0;
+	}
+	smpSize = 16;
+	while (smpSize < (unsigned int)capacity && smpSize < (1u << 20)) {
+		smpSize *= 2;
+	}
+	smpRing = new X52Sample[smpSize];
+	if (anWindow > 0) {
+		anSpectrum = new x52p_spectrum;
+		if (!anSpectrum->Configure(rate, anWindow, anLow, anHigh)) {
+			delete anSpectrum;
+			anSpectrum = NULL;
+		}
+	}
+	if (anSpectrum != NULL) {
+		anSize = 4096;		// Emptied every few ms by the analysis thread
+		anRing = new X52Sample[anSize];
+		anHead = 0;
+		anTail = 0;
+		anSeq = 0;
+		for (int w = 0; w < SpectrumWords; ++w) {
+			anResult[w].store(0, std::memory_order_relaxed);
+		}
+	}
+	smpHead = 0;
+	smpTail = 0;
+	smpDrops = 0;
+	smpPeriodNs = (long long)(1e9 / rate);
+	smpStart = x52p_now_ns();
+	smpStop = false;
+	smpThread = std::thread(&x52p_ctrl::SamplerThread, this);
+	if (anRing != NULL) {
+		anThread = std::thread(&x52p_ctrl::AnalysisThread, this);
+	}
+	return 1;
+}
+
+void x52p_ctrl::StopSampler() {
+	if (smpThread.joinable()) {
+		smpStop = true;
+		smpThread.join();	// Within one period
+	}
+	if (anThread.joinable()) {
+		anThread.join();	// Stops with smpStop too
+	}
+	delete[] smpRing;
+	smpRing = NULL;
+	smpSize = 0;
+	delete[] anRing;
+	anRing = NULL;
+	anSize = 0;
+	delete anSpectrum;
+	anSpectrum = NULL;
+}
+
+// Spectrum of the samples on its own thread, see x52p_spectrum: window in samples (0 none), band in Hz
+// Set before StartSampler(), used from the next start
+void x52p_ctrl::SetAnalysis(int window, double fLo, double fHi) {
+	anWindow = (window > 0) ? window : 0;
+	anLow = fLo;
+	anHigh = fHi;
+}
+
+// Takes the samples from the sampler as they come (every few ms), publishes a result per half window
+void x52p_ctrl::AnalysisThread() {
+	while (!smpStop.load(std::memory_order_relaxed)) {
+		unsigned int tail = anTail.load(std::memory_order_relaxed);
+		unsigned int head = anHead.load(std::memory_order_acquire);
+		if (tail == head) {
+			Sleep(2);
+			continue;
+		}
+		for (; tail != head; ++tail) {
+			const X52Sample& s = anRing[tail & (anSize - 1)];
+			double x[SpectrumAxes];
+			for (int a = 0; a < SpectrumAxes; ++a) {
+				x[a] = (s.state.axes[SpectrumAxisOf[a]] - thrs) / thrs;
+			}
+			if (anSpectrum->Push(x, s.time)) {
+				X52Spectrum r = anSpectrum->GetResult();
+				long long words[SpectrumWords];
+				memcpy(words, &r, sizeof(r));
+				anSeq.fetch_add(1, std::memory_order_relaxed);	// Odd: being written
+				std::atomic_thread_fence(std::memory_order_release);	// The odd count before any word
+				for (int w = 0; w < SpectrumWords; ++w) {
+					anResult[w].store(words[w], std::memory_order_relaxed);
+				}
+				anSeq.fetch_add(1, std::memory_order_release);	// The words before the even count
+			}
+		}
+		anTail.store(tail, std::memory_order_release);
+	}
+}
+
+// Copy of the last result, lock-free (retried if the analysis thread wrote it meanwhile)
+int x52p_ctrl::GetSpectrum(X52Spectrum* out) {
+	if (anRing == NULL) {
+		return 0;
+	}
+	for (;;) {
+		unsigned int seq = anSeq.load(std::memory_order_acquire);
+		if (seq & 1) {
+			YieldProcessor();
+			continue;
+		}
+		long long words[SpectrumWords];
+		for (int w = 0; w < SpectrumWords; ++w) {	// Atomic words: a torn copy is retried, never a data race
+			words[w] = anResult[w].load(std::memory_order_relaxed);
+		}
+		std::atomic_thread_fence(std::memory_order_acquire);	// The words before the count is read again
+		if (anSeq.load(std::memory_order_relaxed) == seq) {
+			memcpy(out, words, sizeof(words));
+			return out->windows > 0;
+		}
+	}
+}
+
+// Absolute deadlines: the rate does not drift with the time the reads take
+void x52p_ctrl::SamplerThread() {
+	HANDLE timer = X52CreateTimer();
+	IDirectInputDevice8* dev = thejoys.x52p_devs[joystick_id];
+	long long next = smpStart;
+	while (!smpStop.load(std::memory_order_relaxed)) {
+		X52SleepUntil(next, timer, SamplerSpinNs);
+		DIJOYSTATE2 st;
+		HRESULT hr = dev->GetDeviceState(sizeof(st), &st);	// DirectInput allows it next to GetState() of the solver
+		long long now = x52p_now_ns();
+		next += smpPeriodNs;
+		if (now - next > 4 * smpPeriodNs) {
+			next = now + smpPeriodNs;	// Far behind (suspended), no burst of samples to catch up
+		}
+		if (hr != DI_OK) {
+			continue;	// No sample, the watchdog of GetState() reports and acquires again
+		}
+
+		unsigned int head = smpHead.load(std::memory_order_relaxed);
+		if (head - smpTail.load(std::memory_order_acquire) >= smpSize) {
+			smpDrops.fetch_add(1, std::memory_order_relaxed);	// Ring full, nobody reads it
+			continue;
+		}
+		X52Sample& s = smpRing[head & (smpSize - 1)];
+		s.time = now;
+		X52StateFromDI(&st, &s.state);
+		smpHead.store(head + 1, std::memory_order_release);
+
+		if (anRing != NULL) {	// Same sample to the analysis, dropped if it is behind
+			unsigned int anH = anHead.load(std::memory_order_relaxed);
+			if (anH - anTail.load(std::memory_order_acquire) < anSize) {
+				anRing[anH & (anSize - 1)] = s;
+				anHead.store(anH + 1, std::memory_order_release);
+			}
+		}
+	}
+	if (timer != NULL) {
+		CloseHandle(timer);
+	}
+}
+
+// Take up to max of the oldest samples, the others stay for the next call
+int x52p_ctrl::ReadSamples(X52Sample* out, int max) {
+	if (smpRing == NULL) {
+		return 0;
+	}
+	unsigned int tail = smpTail.load(std::memory_order_relaxed);
+	unsigned int count = smpHead.load(std::memory_order_acquire) - tail;
+	int n = (count < (unsigned int)max) ? (int)count : max;
+	for (int i = 0; i < n; ++i) {
+		out[i] = smpRing[(tail + i) & (smpSize - 1)];
+	}
+	smpTail.store(tail + n, std::memory_order_release);
+	return n;
+}
+
+// x52p_now_ns() at StartSampler(), the time of the first sample
+long long x52p_ctrl::GetSamplerStart() {
+	return smpStart;
+}
+
+long long x52p_ctrl::GetSamplerDrops() {
+	return smpDrops.load(std::memory_order_relaxed);
+}
+
+//////////////////////////// WATCHDOG /////////////////////////////////////
+// GetState() gives every read to Watchdog() with its result and time (the one of the state, no other clock read):
+//	- a read that fails holds the last good state (not the zeroed one DirectInput leaves), health DEGRADED,
+//	  and the device is acquired again if it was lost (the only call added, on failures only)
+//	- reads failing for longer than stallBound, or giving exactly the same state for longer than freezeBound,
+//	  switch to the failsafe state, health STALLED: the axes take the failsafe of the configuration (X, Y, RZ
+//	  centered and the others held by default, see CONFIGURATION), buttons released, hat centered
+//	- the first good read (with a change, when freezeBound is set) ends it
+// The stall is seen at the first GetState() after the bound: within stallBound plus the time between two polls.
+
+// stallBound, freezeBound: seconds (of the state time: wall clock, or simulation time with a scenario), 0 off
+// freezeBound is off by default: a stick at rest on a desk can give the same state for long
+void x52p_ctrl::SetWatchdog(double stallBound, double freezeBound) {
+	wdStallNs = (stallBound > 0) ? (long long)(stallBound * 1e9) : 0;
+	wdFreezeNs = (freezeBound > 0) ? (long long)(freezeBound * 1e9) : 0;
+	wdGoodTime = wdFreshTime = WatchdogNever;
+	health = HEALTH_OK;
+	stalls = 0;
+}
+
+// Check one read, with the state already in cstate
+void x52p_ctrl::Watchdog(HRESULT hr, long long now) {
+	wdResult = hr;
+	if (wdGoodTime == WatchdogNever) {
+		wdGoodTime = wdFreshTime = now;	// Bounds from the first read
+	}
+	if (hr == DI_OK) {
+		wdGoodTime = now;
+		if (wdFreezeNs == 0 || X52StateDiff(&cstate, &wdLastGood) != 0) {
+			wdFreshTime = now;
+		}
+		wdLastGood = cstate;
+		if ((wdFreezeNs == 0 || now - wdFreshTime <= wdFreezeNs)) {
+			health = HEALTH_OK;
+			return;		// Normal path: compares and one copy
+		}
+	}
+	else {
+		if ((hr == DIERR_INPUTLOST || hr == DIERR_NOTACQUIRED) && scenario == NULL) {
+			thejoys.x52p_devs[joystick_id]->Acquire();	// Unplugged or taken, ready for the next read
+		}
+		cstate = wdLastGood;
+	}
+
+	int stalled = (wdStallNs > 0 && now - wdGoodTime > wdStallNs) || (wdFreezeNs > 0 && now - wdFreshTime > wdFreezeNs);
+	if (!stalled) {
+		health = HEALTH_DEGRADED;
+		X52StateToDI(&cstate, &state);
+		return;
+	}
+	if (health != HEALTH_STALLED) {
+		++stalls;
+	}
+	health = HEALTH_STALLED;
+	const X52Config* c = cfg.load(std::memory_order_acquire);
+	for (int i = 0; i < AxisCount; ++i) {
+		if (c->failsafe[i] >= 0) {
+			cstate.axes[i] = (unsigned short)c->failsafe[i];
+		}
+	}
+	cstate.buttons &= ~X52ButtonBits | (7ULL << X52ModeButton);	// Released, the mode switch stays
+	cstate.hat = X52HatCentered;
+	X52StateToDI(&cstate, &state);
+}
+
+int x52p_ctrl::GetHealth() {
+	return health;
+}
+
+HRESULT x52p_ctrl::GetLastResult() {
+	return wdResult;
+}
+
+// Times the failsafe was entered since SetWatchdog()
+int x52p_ctrl::GetStallCount() {
+	return stalls;
+}
+
+//////////////////////////// INPUT EVENT //////////////////////////////////
+// DirectInput signals an event when the device has new input (SetEventNotification): a loop can sleep in
+// WaitForInput() instead of calling GetState() all the time, no CPU while the stick is still. The event is
+// auto-reset, one waiter: the sampler keeps its fixed rate (the spectrum needs it) and does not use it.
+// The timeout still reads the device, so the watchdog sees a device that is gone.
+
+// on: 1 wait for the device, 0 back to polling. Again after InitDev(), ReleaseDev() drops it
+// Not for a shared object (OPEN_INPUT_SHARED): the notification is one per device, the other objects on the
+// device would lose theirs, and the device would be unacquired under them. Returns 0, poll as before.
+int x52p_ctrl::SetInputEvent(int on) {
+	if (diShared || joystick_id >= (int)thejoys.deviceCount) {
+		return 0;
+	}
+	IDirectInputDevice8* dev = thejoys.x52p_devs[joystick_id];
+	dev->Unacquire();	// The notification is set while not acquired only
+	dev->SetEventNotification(NULL);
+	if (inEvent != NULL) {
+		CloseHandle(inEvent);
+		inEvent = NULL;
+	}
+	int ok = 0;
+	if (on) {
+		inEvent = CreateEvent(NULL, FALSE, FALSE, NULL);
+		// DI_POLLEDDEVICE: signaled only by Poll() of DirectInput, no use here
+		if (inEvent != NULL && dev->SetEventNotification(inEvent) == DI_OK) {
+			ok = 1;
+		}
+		else {
+			dev->SetEventNotification(NULL);
+			CloseHandle(inEvent);
+			inEvent = NULL;
+		}
+	}
+	dev->Acquire();
+	return ok;
+}
+
+// Sleep until the device has new input or timeout (s) passed, then read it (GetState())
+// Without the event (SetInputEvent() off or failed) or with a scenario it reads at once and returns 1.
+int x52p_ctrl::WaitForInput(double timeout) {
+	int signaled = 1;
+	if (inEvent != NULL && scenario == NULL) {
+		X52P_TRACE_SCOPE("WaitForInput");
+		DWORD ms = (timeout > 0) ? (DWORD)(timeout * 1000 + 0.5) : 0;
+		signaled = (WaitForSingleObject(inEvent, ms) == WAIT_OBJECT_0);
+	}
+	GetState();
+	return signaled;
+}
+
+//////////////////////////// DIRECTOUTPUT /////////////////////////////////
+// DirectOutput is one library for the whole process, but every x52p_ctrl object owns its own device.
+// The registry keeps every DirectOutput device once, keyed by its DirectInput instance GUID (device identity),
+// so enumerating again, or a device callback for a device we know, updates the entry instead of adding one.
+// The objects using DirectOutput are listed so that the device callback (one for the process) reaches them,
+// DirectOutput is initialized by the first and stopped (registry emptied) by the last of them.
+struct DODevice
+{
+	void* hDevice;	// Opaque DirectOutput handle
+	GUID instance;	// DirectInput instance GUID, the identity
+};
+static DODevice DOregistry[DOMaxDevices];
+static int DOdeviceCount = 0;
+static x52p_ctrl* DOusers[DOMaxUsers];
+static int DOuserCount = 0;
+static std::recursive_mutex DOlock;	// Callbacks come from the DirectOutput thread, or from within Enumerate
+
+// Put a x52 pro in the registry, or update the handle of a known one
+static void DORegistryAdd(void* hDevice) {
+	GUID type, instance;
+	if (DirectOutput_GetDeviceType(hDevice, &type) != S_OK || !IsEqualGUID(type, DeviceType_X52Pro)) {
+		return;	// Not a x52 pro (e.g. a FIP panel)
+	}
+	if (DirectOutput_GetDeviceInstance(hDevice, &instance) != S_OK) {
+		return;	// Cannot be matched to a DirectInput device
+	}
+	for (int i = 0; i < DOdeviceCount; ++i) {
+		if (IsEqualGUID(DOregistry[i].instance, instance)) {
+			DOregistry[i].hDevice = hDevice;	// Known device, no duplicate
+			return;
+		}
+	}
+	if (DOdeviceCount < DOMaxDevices) {
+		DOregistry[DOdeviceCount].hDevice = hDevice;
+		DOregistry[DOdeviceCount].instance = instance;
+		++DOdeviceCount;
+	}
+}
+
+// Take a device out of the registry (unplugged)
+static void DORegistryRemove(void* hDevice) {
+	for (int i = 0; i < DOdeviceCount; ++i) {
+		if (DOregistry[i].hDevice == hDevice) {
+			DOregistry[i] = DOregistry[--DOdeviceCount];
+			return;
+		}
+	}
+}
+
+// Find the handle of a device by its DirectInput instance GUID, NULL if it is not there
+static void* DORegistryFind(const GUID& instance) {
+	for (int i = 0; i < DOdeviceCount; ++i) {
+		if (IsEqualGUID(DOregistry[i].instance, instance)) {
+			return DOregistry[i].hDevice;
+		}
+	}
+	return NULL;
+}
+
+// Callback to register the devices, added or removed (hot-plug), then offered to every object
+void __stdcall DirectOutput_Device_Callback(void* hDevice, bool bAdded, void* pvContext) {
+	std::lock_guard<std::recursive_mutex> lock(DOlock);
+	if (bAdded) {
+		DORegistryAdd(hDevice);
+	}
+	else {
+		DORegistryRemove(hDevice);
+	}
+	for (int i = 0; i < DOuserCount; ++i) {
+		DOusers[i]->OnDirectOutputDevice(hDevice, bAdded);
+	}
+}
+
+// Callback to enumerate the devices, fills the registry
+void __stdcall DirectOutput_Enumerate_Callback(void* hDevice, void* pvContext) {
+	std::lock_guard<std::recursive_mutex> lock(DOlock);
+	DORegistryAdd(hDevice);
+}
+
+// Callback when the MFD page changes (scroll wheel on the throttle), the context is the x52p_ctrl object
+void __stdcall DirectOutput_Page_Callback(void* hDevice, DWORD dwPage, bool bSetActive, void* pvContext) {
+	x52p_ctrl* c = (x52p_ctrl*)pvContext;
+	c->OnMFDPageChange(dwPage, bSetActive);
+}
+
+// Callback when the soft buttons change (scroll wheel click/up/down), only called while one of our pages is active
+void __stdcall DirectOutput_SoftButton_Callback(void* hDevice, DWORD dwButtons, void* pvContext) {
+	x52p_ctrl* c = (x52p_ctrl*)pvContext;
+	c->OnSoftButtonChange(dwButtons);
+}
+
+// Take our device from the registry, or drop it when removed. Called with DOlock held.
+// The match is the DirectInput instance GUID, so the joystick ID picks both the input and the MFD/LEDs
+// DOdev and mfdActive change under outLock: the scheduler checks both there before a write (ReadyOutput())
+void x52p_ctrl::OnDirectOutputDevice(void* hDevice, bool added) {
+	if (!added) {
+		if (hDevice == DOdev) {
+			std::lock_guard<std::mutex> lock(outLock);
+			DOdev = NULL;		// Unplugged, DirectOutput calls are skipped until it is back
+			mfdActive = -1;
+		}
+		return;
+	}
+
+	void* found = DORegistryFind(diInstance);
+	if (found == NULL || found == DOdev) {
+		return;	// Another x52 pro, owned by the object with that joystick ID, or ours again
+	}
+	{
+		std::lock_guard<std::mutex> lock(outLock);
+		DOdev = found;
+		for (int i = 0; i < LEDCount; ++i) {
+			ledState[i] = LEDUnknown;	// Plugged in again, the LEDs are not what we sent before
+		}
+	}
+	if (DirectOutput_GetSerialNumber(found, DOserial, 64) != S_OK) {
+		DOserial[0] = L'\0';
+	}
+
+	// A device (plugged in again) has none of our callbacks and pages, track the page shown before adding them
+	DirectOutput_RegisterPageCallback(found, *DirectOutput_Page_Callback, (void*)this);
+	DirectOutput_RegisterSoftButtonCallback(found, *DirectOutput_SoftButton_Callback, (void*)this);
+	for (int page = 0; page < mfdPageCount; ++page) {
+		DirectOutput_AddPage(found, dwPage + page, pageDebugName, (page == 0) ? FLAG_SET_AS_ACTIVE : 0);
+	}
+	if (mfdPageCount > 0) {
+		{
+			std::lock_guard<std::mutex> lock(outLock);
+			mfdActive = 0;
+		}
+		FlushMFDPage(0);	// The text kept in memory while unplugged
+	}
+}
+
+static const wchar_t welcome[] = L"MAKI ATSUO";	// Shown on the MFD at start
+
+// Method to initialize the DirectOutput
+void x52p_ctrl::DirectOutputInit() {
+	DOserial[0] = L'\0';
+	StopLEDThread();
+	for (int i = 0; i < LEDCount; ++i) {
+		ledState[i] = LEDUnknown;
+		ledAnim[i].pattern = ANIM_NONE;
+		ledAnim[i].scheduled = 0;
+	}
+	for (int i = 0; i < LEDWheelSlots; ++i) {
+		ledWheel[i] = -1;
+	}
+	ledAnimMask = 0;
+	{
+		std::lock_guard<std::mutex> lock(outLock);	// Nothing pending, budget kept (set before or after the init)
+		DOdev = NULL;		// Until OnDirectOutputDevice() finds ours
+		mfdActive = -1;
+		for (int i = 0; i < OutSlotCount; ++i) {
+			outPrio[i] = (i < LEDCount) ? OUT_PRIO_MODE : OUT_PRIO_MFD;
+		}
+		ZeroMemory(outPending, sizeof(outPending));
+		outReady = 0;
+		ZeroMemory(&outStats, sizeof(outStats));
+		outTokens = outBurst;
+	}
+	{
+		std::lock_guard<std::recursive_mutex> lock(DOlock);
+		for (int i = 0; i < DOuserCount; ++i) {
+			if (DOusers[i] == this) {
+				return;	// Already initialized, nothing is registered twice
+			}
+		}
+		if (DOuserCount >= DOMaxUsers) {
+			return;	// Too many objects, this one works without MFD/LEDs
+		}
+		ZeroMemory(mfdText, sizeof(mfdText));		// Empty MFD pages in memory, before our device gets them
+		ZeroMemory(mfdLength, sizeof(mfdLength));
+		mfdPageCount = 0;
+		sbHead = 0;		// Empty soft button queue
+		sbTail = 0;
+		sbLast = 0;
+		if (DOuserCount == 0) {
+			DirectOutput_Initialize(name);	// Initialize the DirectOutput, first object only
+			DirectOutput_RegisterDeviceCallback(*DirectOutput_Device_Callback, nullptr);	// Register the devices
+			DirectOutput_Enumerate(*DirectOutput_Enumerate_Callback, nullptr);				// Enumerate the devices
+		}
+		DOusers[DOuserCount++] = this;
+		OnDirectOutputDevice(NULL, true);	// Find ours in the registry, registers the callbacks
+	}
+
+	AddMFDPage(pageDebugName, 1);	// AddPage for the device (page 0 is dwPage), activate
+
+	// Set welcome text, kept in memory until the device is plugged in if it is not there
+	SetMDFText(welcome, MFD_LEN(welcome), 0);
+
+	if (DOdev == NULL) {
+		return;	// No x52 pro with our joystick ID, no LED sweep
+	}
+	SetAllLEDGreen();	// Set all LEDS on
+	SetAllLEDOff();		// Set most of the LEDs off
+}
+
+// Method to put text in the MDF DirectOutput, id is the id, use 0 for one device. This is predefined
+void x52p_ctrl::SetMDFTextAuto(int autoflg, int VecTflg) {
+	X52P_TRACE_SCOPE("SetMDFTextAuto");
+	static const wchar_t autoMode[] = L"AUTO MODE", manualMode[] = L"MANUAL MODE";
+	static const wchar_t vecTwin[] = L"VECTWIN ON", parallel[] = L"PARALLEL ON";
+
+	if (autoflg == 1) {
+		SetMDFText(autoMode, MFD_LEN(autoMode), 2);
+		SetLEDPressGreen(17);	// Set LED on the clutch to green
+	}
+	else {
+		SetMDFText(manualMode, MFD_LEN(manualMode), 2);
+		SetLed(17, 0); // Turn of the LED on the clutch
+	}
+
+	if (VecTflg == 1) {
+		SetMDFText(vecTwin, MFD_LEN(vecTwin), 1);
+	}
+	else {
+		SetMDFText(parallel, MFD_LEN(parallel), 1);
+	}
+}
+
+// Method to put text in the MDF DirectOutput, id is the id, use 0 for one device. This is free
+// Writes to the first page (dwPage), see SetMFDPageText() for the other pages
+void x52p_ctrl::SetMDFText(const wchar_t* text, DWORD length, DWORD pos) {
+	SetMFDPageText(0, pos, text, length);
+}
+
+//////////////////////////// MFD PAGES ////////////////////////////////////
+// Method to add a page to the MFD, returns the page index (0, 1, ...) or -1 if there is no room
+// The pages are shown in the order they are added when scrolling with the wheel on the throttle
+int x52p_ctrl::AddMFDPage(const wchar_t* debugName, int activate) {
+	if (mfdPageCount >= MFDPages) {
+		return -1;
+	}
+	int page = mfdPageCount++;
+	void* dev = DOdev;
+	if (dev == NULL) {
+		return page;	// In memory only, added to the device when it is plugged in
+	}
+	DirectOutput_AddPage(dev, dwPage + page, debugName, activate ? FLAG_SET_AS_ACTIVE : 0);
+	if (activate) {
+		std::lock_guard<std::mutex> lock(outLock);
+		mfdActive = page;	// Our own activation may not come back through the page callback
+	}
+	return page;
+}
+
+// Method to put text in a line (pos 0 to 2) of a page in memory
+// Only the page shown on the MFD is pushed to the device, the others just keep the text until shown.
+// Unchanged text is not sent again.
+void x52p_ctrl::SetMFDPageText(int page, DWORD pos, const wchar_t* text, DWORD length) {
+	X52P_TRACE_SCOPE("SetMFDPageText");
+	if (page < 0 || page >= mfdPageCount || pos >= (DWORD)MFDLines) {
+		return;
+	}
+	if (length > (DWORD)MFDChars) {
+		length = MFDChars;	// The MFD can only show sixteen characters
+	}
+
+	std::unique_lock<std::mutex> lock(outLock);	// The scheduler may send this line from another thread
+	wchar_t* line = mfdText[page][pos];
+	if (mfdLength[page][pos] == length && wmemcmp(line, text, length) == 0) {
+		return;
+	}
+	wmemcpy(line, text, length);
+	line[length] = L'\0';
+	mfdLength[page][pos] = length;
+
+	// Written after the text, so either this or the page callback pushes the new text
+	if (mfdActive == page) {
+		SubmitOutput(LEDCount + page * MFDLines + pos);
+		FlushOutputs(lock);
+	}
+}
+
+// Method to put a formatted line (see MFD FORMAT) in a line of a page
+void x52p_ctrl::SetMFDLine(int page, DWORD pos, const MFDLine* line) {
+	SetMFDPageText(page, pos, line->text, line->length);
+}
+
+// Get the index of the page shown on the MFD, -1 if the MFD shows a page of another app
+int x52p_ctrl::GetMFDActivePage() {
+	return mfdActive;
+}
+
+// Method to push the lines of one page in memory to the device
+void x52p_ctrl::FlushMFDPage(int page) {
+	std::unique_lock<std::mutex> lock(outLock);
+	for (int pos = 0; pos < MFDLines; ++pos) {
+		SubmitOutput(LEDCount + page * MFDLines + pos);
+	}
+	FlushOutputs(lock);
+}
+
+// Called from the page callback (DirectOutput thread) when one of our pages is shown or hidden
+void x52p_ctrl::OnMFDPageChange(DWORD page, bool active) {
+	X52P_TRACE_SCOPE("OnMFDPageChange");
+	if (page < dwPage || page >= dwPage + (DWORD)mfdPageCount) {
+		return;
+	}
+	int idx = int(page - dwPage);
+	if (active) {
+		mfdActive = idx;
+		FlushMFDPage(idx);	// Only this page is sent, the text was kept while hidden
+	}
+	else {
+		mfdActive.compare_exchange_strong(idx, -1);	// Hidden, unless another page is already active
+	}
+}
+
+//////////////////////////// MFD FORMAT /////////////////////////////////
+// Render a fixed-point number in out (at least 24 characters), returns the number of characters
+// No locale: the decimal point is always '.', NaN gives "---"
+static int MFDRenderFixed(wchar_t* out, double value, int decimals) {
+	static const double scale[] = { 1.0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6 };
+	wchar_t digits[24];
+	int n = 0, count = 0;
+
+	if (value != value) {	// NaN
+		out[0] = out[1] = out[2] = L'-';
+		return 3;
+	}
+	decimals = decimals < 0 ? 0 : (decimals > 6 ? 6 : decimals);
+	double scaled = (value < 0 ? -value : value) * scale[decimals] + 0.5;	// Round half away from zero
+	if (scaled >= 1e17) {
+		out[0] = L'#';	// Too large, does not fit anyway
+		return 1;
+	}
+
+	unsigned long long mag = (unsigned long long)scaled;
+	if (value < 0 && mag != 0) {
+		out[count++] = L'-';	// No "-0.0"
+	}
+	do {	// Digits in reverse order, with the decimal point after the decimals
+		if (n == decimals && decimals > 0) {
+			digits[n++] = L'.';
+		}
+		digits[n++] = wchar_t(L'0' + mag % 10);
+		mag /= 10;
+	} while (mag != 0 || n <= decimals);
+
+	while (n > 0) {
+		out[count++] = digits[--n];
+	}
+	return count;
+}
+
+// Append count characters to a line right aligned in width (0 for no alignment)
+// A value wider than width is shown as width times '#', so a wrong number is never shown
+static void MFDPutAligned(MFDLine* line, const wchar_t* chars, int count, int width) {
+	int pad = width - count;
+	if (width > 0 && pad < 0) {
+		for (int i = 0; i < width && line->length < (DWORD)MFDChars; ++i) {
+			line->text[line->length++] = L'#';
+		}
+	}
+	else {
+		for (int i = 0; i < pad && line->length < (DWORD)MFDChars; ++i) {
+			line->text[line->length++] = L' ';
+		}
+		for (int i = 0; i < count && line->length < (DWORD)MFDChars; ++i) {
+			line->text[line->length++] = chars[i];
+		}
+	}
+	line->text[line->length] = L'\0';
+}
+
+// Empty the line
+void MFDClear(MFDLine* line) {
+	line->length = 0;
+	line->text[0] = L'\0';
+}
+
+// Append text to the line, cut at the end of the MFD line
+void MFDPutText(MFDLine* line, const wchar_t* text) {
+	while (*text != L'\0' && line->length < (DWORD)MFDChars) {
+		line->text[line->length++] = *text++;
+	}
+	line->text[line->length] = L'\0';
+}
+
+// Append an integer, right aligned in width characters (0 for no alignment)
+void MFDPutInt(MFDLine* line, long long value, int width) {
+	wchar_t buf[24];
+	int n = MFDRenderFixed(buf, double(value), 0);
+	MFDPutAligned(line, buf, n, width);
+}
+
+// Append a fixed-point number with decimals (0 to 6), right aligned in width characters (0 for no alignment)
+void MFDPutFixed(MFDLine* line, double value, int decimals, int width) {
+	wchar_t buf[24];
+	int n = MFDRenderFixed(buf, value, decimals);
+	MFDPutAligned(line, buf, n, width);
+}
+
+// Format a whole line as label on the left and value with unit on the right, e.g. "ALT      1250.0M"
+// When it does not fit, the label is cut first, then the unit
+void MFDFormatValue(MFDLine* line, const wchar_t* label, double value, int decimals, const wchar_t* unit) {
+	wchar_t buf[24];
+	int n = MFDRenderFixed(buf, value, decimals);
+	int nUnit = 0, nLabel = 0;
+	while (unit != NULL && unit[nUnit] != L'\0') {
+		++nUnit;
+	}
+	while (label != NULL && label[nLabel] != L'\0') {
+		++nLabel;
+	}
+	if (n + nUnit > MFDChars) {
+		nUnit = n < MFDChars ? MFDChars - n : 0;
+	}
+	if (nLabel > MFDChars - n - nUnit) {
+		nLabel = MFDChars - n - nUnit > 0 ? MFDChars - n - nUnit : 0;
+	}
+
+	MFDClear(line);
+	for (int i = 0; i < nLabel; ++i) {
+		line->text[line->length++] = label[i];
+	}
+	MFDPutAligned(line, buf, n, MFDChars - nLabel - nUnit);
+	for (int i = 0; i < nUnit && line->length < (DWORD)MFDChars; ++i) {
+		line->text[line->length++] = unit[i];
+	}
+	line->text[line->length] = L'\0';
+}
+
+//////////////////////////// SOFT BUTTONS ///////////////////////////////
+// Called from the soft button callback (DirectOutput thread), queues the newly pressed buttons
+// A short press is a press and a release between two callbacks, it is queued even if no step sees it held
+void x52p_ctrl::OnSoftButtonChange(DWORD buttons) {
+	DWORD pressed = buttons & ~sbLast;	// Rising edges only, SoftButton_Select/Up/Down
+	sbLast = buttons;
+	if (pressed == 0) {
+		return;
+	}
+
+	unsigned int head = sbHead.load(std::memory_order_relaxed);
+	if (head - sbTail.load(std::memory_order_acquire) >= SoftButtonQueueSize) {
+		return;	// Queue full, nobody reads it, drop
+	}
+	sbQueue[head & (SoftButtonQueueSize - 1)] = pressed;
+	sbHead.store(head + 1, std::memory_order_release);
+}
+
+// Take the oldest soft button press from the queue, returns 0 if the queue is empty
+int x52p_ctrl::PopSoftButton(DWORD* pressed) {
+	unsigned int tail = sbTail.load(std::memory_order_relaxed);
+	if (tail == sbHead.load(std::memory_order_acquire)) {
+		return 0;
+	}
+	*pressed = sbQueue[tail & (SoftButtonQueueSize - 1)];
+	sbTail.store(tail + 1, std::memory_order_release);
+	return 1;
+}
+
+// Count the presses of select, up, and down since the last call, empties the queue
+void x52p_ctrl::GetSoftButtonCounts(int counts[3]) {
+	DWORD pressed;
+	counts[0] = counts[1] = counts[2] = 0;
+	while (PopSoftButton(&pressed)) {
+		counts[0] += (pressed & SoftButton_Select) ? 1 : 0;
+		counts[1] += (pressed & SoftButton_Up) ? 1 : 0;
+		counts[2] += (pressed & SoftButton_Down) ? 1 : 0;
+	}
+}
+
+// Method to put text in the landing page
+void x52p_ctrl::SetMDFLanding() {
+	static const wchar_t landing[] = L"ATSUO MAKI";
+	SetMDFText(landing, MFD_LEN(landing), 0);
+}
+
+// Method to set one LED (0 to 19) to on (1) or off (0), only sent to the device when it changes
+// Other IDs (e.g. from a loop over the buttons) are not LEDs and are not sent
+// LEDs with an animation pattern are left to the animation thread, see SetLEDPattern()
+void x52p_ctrl::SetLed(DWORD id, DWORD value) {
+	if (id >= (DWORD)LEDCount || (ledAnimMask.load(std::memory_order_relaxed) >> id & 1)) {
+		return;
+	}
+	SendLed(id, value);
+}
+
+// Send one LED if it changes, no check of the animation (used by the animation itself)
+void x52p_ctrl::SendLed(DWORD id, DWORD value) {
+	std::unique_lock<std::mutex> lock(outLock);
+	if (ledState[id] == value) {
+		return;
+	}
+	ledState[id] = value;	// What the device will show, the scheduler sends it
+	outLed[id] = value;
+	SubmitOutput(id);
+	FlushOutputs(lock);
+}
+
+// Method to change LED in the DirectOuput: green, red, and yellow only, and off
+void x52p_ctrl::SetLEDPressYellow(DWORD b_id) {
+	X52P_TRACE_SCOPE("SetLEDPressYellow");
+	SetLed(b_id, 1);
+	SetLed(b_id + 1, 1);
+}
+
+void x52p_ctrl::SetLEDPressRed(DWORD b_id) {
+	X52P_TRACE_SCOPE("SetLEDPressRed");
+	SetLed(b_id, 1);
+}
+
+void x52p_ctrl::SetLEDPressGreen(DWORD b_id) {
+	X52P_TRACE_SCOPE("SetLEDPressGreen");
+	SetLed(b_id + 1, 1);
+}
+
+void x52p_ctrl::SetLEDOff(DWORD b_id) {
+	X52P_TRACE_SCOPE("SetLEDOff");
+	if (b_id == 0) {
+		//SetLed(b_id, 1);
+		return;
+	}
+	else if (b_id > 16 && b_id < 20) {
+		return;
+	}
+	else {
+		SetLed(b_id, 0);
+		SetLed(b_id + 1, 0);
+	}
+		
+}
+
+void x52p_ctrl::SetAllLEDGreen() {
+	int i;
+	for (i = 1; i < 19; ++i) {
+		if (i % 2 == 0 && i != 0) {
+			SetLed(i, 1); // All except the fire button and throttle
+		}
+	}
+}
+
+void x52p_ctrl::SetAllLEDOff() {
+	int i;
+	for (i = 0; i < 19; ++i) {
+		if (i % 2 == 0 && i != 0) {
+			SetLed(i, 0); // All except the fire button and throttle
+		}
+	}
+}
+
+// Put the LEDs and the MFD back to the state after DirectOutputInit(), for a warm start
+// Only what differs is sent to the device, there is no LED sweep
+void x52p_ctrl::ResetOutputs() {
+	for (DWORD b_id = 0; b_id < (DWORD)LEDCount; b_id = (b_id == 0) ? 1 : b_id + 2) {
+		SetLEDPattern(b_id, ANIM_NONE, LED_OFF, LED_OFF, 0);	// No animation left from the last run
+	}
+	for (DWORD b_id = 1; b_id < 17; b_id += 2) {
+		SetLEDOff(b_id);	// Red and green of A, B, D, E, toggles, and POV 2
+	}
+	SetLed(17, 0);		// Clutch red and green
+	SetLed(18, 0);
+
+	for (int page = 0; page < mfdPageCount; ++page) {
+		for (DWORD pos = 0; pos < (DWORD)MFDLines; ++pos) {
+			SetMFDPageText(page, pos, L"", 0);
+		}
+	}
+	SetMDFText(welcome, MFD_LEN(welcome), 0);
+
+	sbTail = sbHead.load();	// Forget the soft buttons pressed between the runs
+}
+
+// Method to stop the DirectOutput, the library is stopped with the last object using it
+// Safe to call again, e.g. from mdlTerminate and then from the destructor
+void x52p_ctrl::DirectOutputStop() {
+	StopLEDThread();	// No LED animation without DirectOutput
+	std::lock_guard<std::recursive_mutex> lock(DOlock);
+	int user = 0;
+	while (user < DOuserCount && DOusers[user] != this) {
+		++user;
+	}
+	if (user < DOuserCount) {
+		DOusers[user] = DOusers[--DOuserCount];
+		if (DOdev != NULL) {
+			DetachDirectOutput();
+		}
+		if (DOuserCount == 0) {
+			DirectOutput_Deinitialize();
+			DOdeviceCount = 0;	// Handles are gone with the library
+		}
+	}
+	std::lock_guard<std::mutex> out(outLock);	// A write of the scheduler checks them under it
+	DOdev = NULL;
+	mfdActive = -1;
+}
+
+// Leave nothing of this object on its device, the callbacks would reach a deleted object. Called with DOlock held.
+// The callbacks are for the device, not the object: another object on the same device (same joystick ID) takes
+// them over and keeps the pages it added.
+void x52p_ctrl::DetachDirectOutput() {
+	x52p_ctrl* other = NULL;
+	for (int i = 0; i < DOuserCount; ++i) {
+		if (DOusers[i]->DOdev == DOdev) {
+			other = DOusers[i];
+		}
+	}
+	if (other != NULL) {
+		DirectOutput_RegisterPageCallback(DOdev, *DirectOutput_Page_Callback, (void*)other);
+		DirectOutput_RegisterSoftButtonCallback(DOdev, *DirectOutput_SoftButton_Callback, (void*)other);
+	}
+	else {
+		DirectOutput_RegisterPageCallback(DOdev, NULL, NULL);
+		DirectOutput_RegisterSoftButtonCallback(DOdev, NULL, NULL);
+	}
+	for (int page = (other != NULL) ? other->mfdPageCount : 0; page < mfdPageCount; ++page) {
+		DirectOutput_RemovePage(DOdev, dwPage + page);
+	}
+}
+
+//////////////////////////// TIME /////////////////////////////////////////
+static long long QpcFrequency() {
+	LARGE_INTEGER freq;
+	QueryPerformanceFrequency(&freq);
+	return freq.QuadPart;
+}
+
+// Monotonic time in nanoseconds (QueryPerformanceCounter), for measuring and timestamps
+// Called from several threads (sampler, fusion, caller), the frequency is a function-local static: initialized
+// once, thread-safe (C++11)
+long long x52p_now_ns() {
+	static const long long freq = QpcFrequency();
+	LARGE_INTEGER now;
+	QueryPerformanceCounter(&now);
+	// Split to avoid overflow of now * 1e9
+	return (now.QuadPart / freq) * 1000000000LL + (now.QuadPart % freq) * 1000000000LL / freq;
+}
+
+// Waitable timer for X52SleepUntil(), high resolution when the system has it, NULL if none. CloseHandle() it
+HANDLE X52CreateTimer() {
+	HANDLE timer = CreateWaitableTimerExW(NULL, NULL, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+	if (timer == NULL) {
+		timer = CreateWaitableTimer(NULL, TRUE, NULL);	// Before Windows 10 1803, coarser
+	}
+	return timer;
+}
+
+// Wait until deadline (x52p_now_ns() time): the waitable timer for most of it, then spin for the last spinNs
+// The timer wakes up to a scheduler tick late (about 0.5 ms with a high resolution timer, 1 to 15 ms without),
+// the spin takes the rest. timer: CreateWaitableTimerExW(..., CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, ...), or NULL
+void X52SleepUntil(long long deadline, HANDLE timer, long long spinNs) {
+	long long wait = deadline - spinNs - x52p_now_ns();
+	if (wait > 0) {
+		if (timer != NULL) {
+			LARGE_INTEGER due;
+			due.QuadPart = -(wait / 100);	// Relative, in 100 ns
+			if (SetWaitableTimer(timer, &due, 0, NULL, NULL, FALSE)) {
+				WaitForSingleObject(timer, INFINITE);
+			}
+		}
+		else {
+			Sleep((DWORD)(wait / 1000000));
+		}
+	}
+	while (x52p_now_ns() < deadline) {
+		YieldProcessor();
+	}
+}
+
+//////////////////////////// TRACE ////////////////////////////////////////
+// Each thread records its events in its own ring (no lock, the oldest events are overwritten), the rings
+// are kept after the thread ends for the export, and given to the next new thread.
+// The events are stamped with the time stamp counter (a few ns, QPC is slower), converted to ns at the
+// export against x52p_now_ns() (invariant TSC, every x64 CPU of the last decade).
+// Export when the threads are quiet (e.g. mdlTerminate), an event written during the export may be torn.
+#ifdef X52P_TRACE
+const unsigned int TraceRingSize = 16384;	// Events per thread, must be a power of two
+const int TraceMaxRings = 64;
+
+struct X52TraceRing
+{
+	X52TraceEvent events[TraceRingSize];
+	std::atomic<unsigned int> count{ 0 };	// Events written, the last TraceRingSize are kept
+	int tid;
+	int used;		// Owned by a running thread
+};
+
+static X52TraceRing* traceRings[TraceMaxRings];
+static int traceRingCount = 0, traceNextTid = 1;
+static std::mutex traceLock;
+static long long traceTsc0 = 0, traceNs0 = 0;	// Reference for the conversion to ns, at the first ring
+
+// Gives the ring back when its thread ends
+struct X52TraceOwner
+{
+	X52TraceRing* ring = NULL;
+	~X52TraceOwner() {
+		if (ring != NULL) {
+			std::lock_guard<std::mutex> lock(traceLock);
+			ring->used = 0;
+		}
+	}
+};
+static thread_local X52TraceOwner traceOwner;
+static thread_local X52TraceRing* traceRing = NULL;	// Same ring, a plain pointer is faster to reach
+
+// Ring of this thread, taken at its first event, NULL if there are too many threads (events dropped)
+static X52TraceRing* TraceRingOfThread() {
+	std::lock_guard<std::mutex> lock(traceLock);
+	X52TraceRing* ring = NULL;
+	for (int i = 0; i < traceRingCount && ring == NULL; ++i) {
+		if (!traceRings[i]->used) {
+			ring = traceRings[i];	// From a thread that ended, its events stay with their tid
+		}
+	}
+	if (ring == NULL && traceRingCount < TraceMaxRings) {
+		if (traceRingCount == 0) {
+			traceTsc0 = (long long)__rdtsc();
+			traceNs0 = x52p_now_ns();
+		}
+		ring = new X52TraceRing;
+		traceRings[traceRingCount++] = ring;
+	}
+	if (ring != NULL) {
+		ring->used = 1;
+		ring->tid = traceNextTid++;
+	}
+	return ring;
+}
+
+X52TraceScope::~X52TraceScope() {
+	long long end = (long long)__rdtsc();
+	X52TraceRing* ring = traceRing;
+	if (ring == NULL) {
+		ring = traceRing = traceOwner.ring = TraceRingOfThread();
+		if (ring == NULL) {
+			return;
+		}
+	}
+	unsigned int n = ring->count.load(std::memory_order_relaxed);
+	X52TraceEvent& e = ring->events[n & (TraceRingSize - 1)];
+	e.name = name;
+	e.begin = begin;
+	e.end = end;
+	e.tid = ring->tid;
+	ring->count.store(n + 1, std::memory_order_release);
+}
+
+// Write the events of all threads as Chrome trace JSON ("X" complete events, microseconds from the first event)
+// Returns 1 if written, 0 if the file cannot be opened
+int X52TraceExport(const char* path) {
+	FILE* f = fopen(path, "w");
+	if (f == NULL) {
+		return 0;
+	}
+	std::lock_guard<std::mutex> lock(traceLock);
+	long long tsc = (long long)__rdtsc(), ns = x52p_now_ns();
+	double nsPerTick = (tsc > traceTsc0) ? double(ns - traceNs0) / double(tsc - traceTsc0) : 1.0;
+	long long t0 = -1;
+	for (int r = 0; r < traceRingCount; ++r) {
+		unsigned int n = traceRings[r]->count.load(std::memory_order_acquire);
+		for (unsigned int i = (n > TraceRingSize) ? n - TraceRingSize : 0; i < n; ++i) {
+			long long b = traceRings[r]->events[i & (TraceRingSize - 1)].begin;
+			if (t0 < 0 || b < t0) {
+				t0 = b;
+			}
+		}
+	}
+	fprintf(f, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+	const char* sep = "";
+	for (int r = 0; r < traceRingCount; ++r) {
+		unsigned int n = traceRings[r]->count.load(std::memory_order_acquire);
+		for (unsigned int i = (n > TraceRingSize) ? n - TraceRingSize : 0; i < n; ++i) {
+			const X52TraceEvent& e = traceRings[r]->events[i & (TraceRingSize - 1)];
+			fprintf(f, "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+				sep, e.name, e.tid, (e.begin - t0) * nsPerTick * 1e-3, (e.end - e.begin) * nsPerTick * 1e-3);
+			sep = ",\n";
+		}
+	}
+	fprintf(f, "\n]}\n");
+	fclose(f);
+	return 1;
+}
+
+// Forget the events recorded so far
+void X52TraceClear() {
+	std::lock_guard<std::mutex> lock(traceLock);
+	for (int r = 0; r < traceRingCount; ++r) {
+		traceRings[r]->count = 0;
+	}
+}
+#endif
+
+//////////////////////////// WARM START ///////////////////////////////////
+// Objects kept between runs (e.g. Simulink runs in a MEX file that stays loaded), one per joystick ID.
+// A kept object keeps its device acquired and DirectOutput running, so the next run skips
+// DirectInput8Create, the enumeration, DirectOutput_Initialize, AddPage, and the LED sweep.
+static x52p_ctrl* warmSessions[DOMaxUsers];
+static int warmCount = 0;
+
+// Take the kept object of this joystick ID, NULL if there is none (then make a new one, cold start)
+// The LEDs and the MFD are reset with ResetOutputs()
+x52p_ctrl* WarmStartTake(int id) {
+	for (int i = 0; i < warmCount; ++i) {
+		if (warmSessions[i]->GetDevID() == id) {
+			x52p_ctrl* c = warmSessions[i];
+			warmSessions[i] = warmSessions[--warmCount];
+			c->ResetOutputs();
+			return c;
+		}
+	}
+	return NULL;
+}
+
+// Keep the object for the next run instead of deleting it, returns 0 if it was deleted (no room)
+int WarmStartKeep(x52p_ctrl* c) {
+	if (warmCount >= DOMaxUsers) {
+		delete c;
+		return 0;
+	}
+	warmSessions[warmCount++] = c;
+	return 1;
+}
+
+// Delete the kept object of this joystick ID, or all of them with -1: unacquire, stop DirectOutput, release
+void WarmStartRelease(int id) {
+	for (int i = warmCount - 1; i >= 0; --i) {
+		if (id < 0 || warmSessions[i]->GetDevID() == id) {
+			x52p_ctrl* c = warmSessions[i];
+			warmSessions[i] = warmSessions[--warmCount];
+			delete c;
+		}
+	}
+}
+
+// Number of kept objects
+int WarmStartCount() {
+	return warmCount;
+}
+
+//////////////////////////// MAPPING //////////////////////////////////////
+// Compile the rules into the instruction array, returns -1 if all rules are fine,
+// else the index of the first bad rule and the running instructions are not touched
+int x52p_map::Compile(const MapRule* rules, int count) {
+	if (count < 0 || count > MapMaxRules) {
+		return count < 0 ? 0 : MapMaxRules;	// The first rule that does not fit
+	}
+
+	// Check everything before touching the running instructions
+	unsigned long long modifiers = 0;	// Buttons used as shift layer
+	for (int i = 0; i < count; ++i) {
+		const MapRule& r = rules[i];
+		int srcMax = (r.type == MAP_AXIS) ? AxisCount : ButtonCount;
+		if (r.type < MAP_AXIS || r.type > MAP_HAT_Y || r.out < 0 || r.out >= MapMaxOutputs) {
+			return i;
+		}
+		if (r.type != MAP_HAT_X && r.type != MAP_HAT_Y && (r.src < 0 || r.src >= srcMax)) {
+			return i;
+		}
+		if (r.type == MAP_AXIS_FROM_BUTTONS && (r.src2 < -1 || r.src2 >= ButtonCount)) {
+			return i;
+		}
+		if (r.layer < MAP_ANY_LAYER || r.layer >= ButtonCount) {
+			return i;
+		}
+		if (r.layer >= 0) {
+			modifiers |= 1ULL << r.layer;
+		}
+	}
+
+	// Flat instructions, grouped by operation so that the loop in Eval() branches the same way in a row
+	codeCount = 0;
+	outCount = 0;
+	for (int op = MAP_AXIS; op <= MAP_HAT_Y; ++op) {
+		for (int i = 0; i < count; ++i) {
+			const MapRule& r = rules[i];
+			if (r.type != op) {
+				continue;
+			}
+			MapInstr& in = code[codeCount++];
+			in.op = (unsigned char)r.type;
+			in.src = (unsigned char)(r.src < 0 ? 0 : r.src);
+			in.src2 = (r.src2 < 0) ? 0 : (unsigned char)r.src2;
+			in.hasSrc2 = (r.src2 >= 0);
+			in.out = (unsigned short)r.out;
+			in.gain = r.gain;
+			if (r.layer == MAP_ANY_LAYER) {	// Always
+				in.condMask = 0;
+				in.condValue = 0;
+			}
+			else if (r.layer == MAP_NO_LAYER) {	// Base layer: no shift button held
+				in.condMask = modifiers;
+				in.condValue = 0;
+			}
+			else {	// Shift layer: this button held
+				in.condMask = 1ULL << r.layer;
+				in.condValue = 1ULL << r.layer;
+			}
+			if (r.out >= outCount) {
+				outCount = r.out + 1;
+			}
+		}
+	}
+	Reset();
+	return -1;
+}
+
+// Number of logical outputs (largest output index + 1)
+int x52p_map::GetOutputNum() {
+	return outCount;
+}
+
+// Set toggles and axes from buttons back to 0
+void x52p_map::Reset() {
+	for (int i = 0; i < MapMaxRules; ++i) {
+		memory[i] = 0.0;
+	}
+	prevButtons = 0;
+}
+
+// Evaluate the instructions on the state of c (after GetState), dt is the time since the last call in seconds
+// out must have GetOutputNum() elements, rules writing the same output are added.
+// A rule in a layer that is not held adds nothing, but toggles and axes from buttons keep their value.
+void x52p_map::Eval(x52p_ctrl* c, double dt, double* out) {
+	X52P_TRACE_SCOPE("x52p_map::Eval");
+	// Hat direction (every 45 deg, up is 0) to the two virtual axes
+	static const double hatX[8] = { 0, 1, 1, 1, 0, -1, -1, -1 };
+	static const double hatY[8] = { 1, 1, 0, -1, -1, -1, 0, 1 };
+
+	const X52State& st = c->GetCompactState();
+	double axes[AxisCount];
+	c->GetAxes(axes);
+	unsigned long long buttons = st.buttons;
+	unsigned long long pressed = buttons & ~prevButtons;	// Rising edges, for the toggles
+	int hat = (st.hat == X52HatCentered) ? -1 : st.hat;
+
+	for (int i = 0; i < outCount; ++i) {
+		out[i] = 0.0;
+	}
+
+	for (int i = 0; i < codeCount; ++i) {
+		const MapInstr& in = code[i];
+		int active = (buttons & in.condMask) == in.condValue;
+		switch (in.op) {
+		case MAP_AXIS:
+			out[in.out] += active ? axes[in.src] * in.gain : 0.0;
+			break;
+		case MAP_BUTTON:
+			out[in.out] += (active && (buttons >> in.src & 1)) ? in.gain : 0.0;
+			break;
+		case MAP_TOGGLE:
+			if (active && (pressed >> in.src & 1)) {
+				memory[i] = (memory[i] != 0.0) ? 0.0 : in.gain;
+			}
+			out[in.out] += memory[i];
+			break;
+		case MAP_AXIS_FROM_BUTTONS:
+			if (active) {
+				double dir = double(buttons >> in.src & 1) - (in.hasSrc2 ? double(buttons >> in.src2 & 1) : 0.0);
+				double v = memory[i] + dir * in.gain * dt;
+				memory[i] = v > 1.0 ? 1.0 : (v < -1.0 ? -1.0 : v);
+			}
+			out[in.out] += memory[i];
+			break;
+		case MAP_HAT_X:
+			out[in.out] += (active && hat >= 0) ? hatX[hat] * in.gain : 0.0;
+			break;
+		case MAP_HAT_Y:
+			out[in.out] += (active && hat >= 0) ? hatY[hat] * in.gain : 0.0;
+			break;
+		}
+	}
+	prevButtons = buttons;
+}
+
+//////////////////////////// GESTURES /////////////////////////////////////
+// Index of the lowest set bit, the mask must not be 0
+static inline int LowestBit(unsigned long long mask) {
+	unsigned long idx;
+	_BitScanForward64(&idx, mask);
+	return int(idx);
+}
+
+x52p_gesture::x52p_gesture() {
+	ZeroMemory(pressTime, sizeof(pressTime));
+	ZeroMemory(releaseTime, sizeof(releaseTime));
+}
+
+// Set the time windows in seconds: long press, double tap, chord
+void x52p_gesture::SetWindows(double longPress, double doubleTap, double chord) {
+	longNs = (long long)(longPress * 1e9);
+	doubleNs = (long long)(doubleTap * 1e9);
+	chordNs = (long long)(chord * 1e9);
+}
+
+// Add a chord (bit i for button i), returns its index for GESTURE_CHORD events, -1 if there is no room
+int x52p_gesture::AddChord(unsigned long long buttons) {
+	if (chordCount >= GestureMaxChords || buttons == 0) {
+		return -1;
+	}
+	chords[chordCount] = buttons;
+	return chordCount++;
+}
+
+void x52p_gesture::Emit(int type, int id) {
+	if (eventCount < GestureMaxEvents) {
+		events[eventCount].type = (unsigned char)type;
+		events[eventCount].id = (unsigned char)id;
+		++eventCount;
+	}
+}
+
+// Give the buttons (GetButtonMask()) and the time in ns (x52p_now_ns()), returns the number of events in GetEvents()
+int x52p_gesture::Update(unsigned long long buttons, long long now) {
+	X52P_TRACE_SCOPE("x52p_gesture::Update");
+	unsigned long long changed = buttons ^ prev;
+	unsigned long long pressed = changed & buttons;
+	unsigned long long released = changed & prev;
+	eventCount = 0;
+
+	for (unsigned long long m = pressed; m != 0; m &= m - 1) {
+		int b = LowestBit(m);
+		Emit(GESTURE_PRESS, b);
+		if ((shortTap >> b & 1) && now - releaseTime[b] <= doubleNs) {
+			Emit(GESTURE_DOUBLE, b);
+			shortTap &= ~(1ULL << b);
+		}
+		pressTime[b] = now;
+		if (waitLong == 0 || now + longNs < nextLong) {
+			nextLong = now + longNs;
+		}
+		waitLong |= 1ULL << b;
+	}
+
+	for (unsigned long long m = released; m != 0; m &= m - 1) {
+		int b = LowestBit(m);
+		Emit(GESTURE_RELEASE, b);
+		if (waitLong >> b & 1) {
+			shortTap |= 1ULL << b;		// Released before the long press, a tap
+		}
+		else {
+			shortTap &= ~(1ULL << b);	// After a long press, no double tap
+		}
+		releaseTime[b] = now;
+	}
+	waitLong &= buttons;
+
+	// Long presses, only when the earliest one is due
+	if (waitLong != 0 && now >= nextLong) {
+		long long next = 0;
+		for (unsigned long long m = waitLong; m != 0; m &= m - 1) {
+			int b = LowestBit(m);
+			if (now - pressTime[b] >= longNs) {
+				Emit(GESTURE_LONG, b);
+				waitLong &= ~(1ULL << b);
+			}
+			else if (next == 0 || pressTime[b] + longNs < next) {
+				next = pressTime[b] + longNs;
+			}
+		}
+		nextLong = next;
+	}
+
+	// Chords completed by this press, all their buttons pressed within the chord window
+	if (pressed != 0) {
+		for (int i = 0; i < chordCount; ++i) {
+			unsigned long long c = chords[i];
+			if ((pressed & c) == 0 || (buttons & c) != c) {
+				continue;
+			}
+			long long first = now;
+			for (unsigned long long m = c; m != 0; m &= m - 1) {
+				long long t = pressTime[LowestBit(m)];
+				first = t < first ? t : first;
+			}
+			if (now - first <= chordNs) {
+				Emit(GESTURE_CHORD, i);
+			}
+		}
+	}
+
+	prev = buttons;
+	return eventCount;
+}
+
+// The events of the last Update()
+const GestureEvent* x52p_gesture::GetEvents() {
+	return events;
+}
+
+//////////////////////////// PREDICTION ///////////////////////////////////
+// Per axis: x, v the filtered position and velocity, z the new sample after dt seconds
+//	x' = x + v dt, r = z - x', x = x' + alpha r, v = v + beta r / dt, prediction x + v lead
+// A gap longer than PredictMaxGap (e.g. a pause) starts again from the sample, without velocity.
+const double PredictMaxGap = 0.25;
+
+// Range of each normalized axis (X, Y, RZ -1 to 1, the others 0 to 1), and the axes with a deadzone
+static const double predictMin[AxisCount] = { -1, -1, 0, 0, 0, -1, 0 };
+static const int predictDeadzone[AxisCount] = { 1, 1, 1, 0, 0, 1, 0 };
+
+// Set the gains, alpha on the position and beta on the velocity, 0 to 1 (larger follows faster, more noise)
+void x52p_predict::SetGains(double a, double b) {
+	alpha = (a < 0) ? 0 : (a > 1 ? 1 : a);
+	beta = (b < 0) ? 0 : (b > 1 ? 1 : b);
+}
+
+// Forget the samples
+void x52p_predict::Reset() {
+	valid = 0;
+}
+
+// Give a new sample of the normalized axes (X52Normalize()) and its time in ns (GetStateTime())
+void x52p_predict::Update(const double axes[AxisCount], long long time) {
+	double dt = (time - last) * 1e-9;
+	if (!valid || dt <= 0 || dt > PredictMaxGap) {
+		for (int i = 0; i < AxisCount; ++i) {
+			pos[i] = axes[i];
+			vel[i] = 0;
+		}
+		valid = 1;
+		last = time;
+		return;
+	}
+	last = time;
+	for (int i = 0; i < AxisCount; ++i) {
+		if (predictDeadzone[i] && axes[i] == 0.0) {
+			pos[i] = 0;	// In the deadzone: at rest, no drift out of it
+			vel[i] = 0;
+			continue;
+		}
+		double x = pos[i] + vel[i] * dt;
+		double r = axes[i] - x;
+		pos[i] = x + alpha * r;
+		vel[i] += beta * r / dt;
+	}
+}
+
+// Extrapolate the axes lead seconds after the last sample, in the range of each axis
+void x52p_predict::Predict(double lead, double out[AxisCount]) {
+	for (int i = 0; i < AxisCount; ++i) {
+		if (!valid) {
+			out[i] = 0;
+			continue;
+		}
+		double x = pos[i] + vel[i] * lead;
+		out[i] = (x < predictMin[i]) ? predictMin[i] : (x > 1 ? 1 : x);
+	}
+}
+
+//////////////////////////// CHANGE GATE //////////////////////////////////
+// Set the thresholds of all axes, in raw units (0 to 65535), exit should be smaller than enter
+void x52p_gate::SetThresholds(unsigned short enterAll, unsigned short exitAll) {
+	for (int i = 0; i < AxisCount; ++i) {
+		SetAxisThresholds(i, enterAll, exitAll);
+	}
+}
+
+void x52p_gate::SetAxisThresholds(int axis, unsigned short enterAxis, unsigned short exitAxis) {
+	if (axis < 0 || axis >= AxisCount) {
+		return;
+	}
+	enter[axis] = enterAxis;
+	exit[axis] = (exitAxis < enterAxis) ? exitAxis : enterAxis;
+}
+
+// Forget the state, the next Update() reports every field
+void x52p_gate::Reset() {
+	valid = 0;
+	moving = 0;
+}
+
+// Give the new state, returns the fields that changed enough: bits 0 to 6 the axes, X52FieldHat, X52FieldMode,
+// X52FieldButton0 + i. A still stick costs one X52StateDiff().
+unsigned long long x52p_gate::Update(const X52State* s) {
+	if (!valid) {
+		ref = *s;
+		valid = 1;
+		return (1ULL << (X52FieldButton0 + ButtonCount)) - 1;	// All fields, as if they all changed
+	}
+	unsigned long long diff = X52StateDiff(&ref, s);
+	if (diff == 0) {
+		moving = 0;
+		return 0;
+	}
+
+	unsigned int wasMoving = moving;
+	moving = 0;
+	for (unsigned long long axes = diff & ((1ULL << AxisCount) - 1); axes != 0; axes &= axes - 1) {
+		int i = LowestBit(axes);
+		int d = abs(int(s->axes[i]) - int(ref.axes[i]));
+		if (d >= ((wasMoving >> i & 1) ? exit[i] : enter[i])) {
+			ref.axes[i] = s->axes[i];	// Reported, the next move is from here
+			moving |= 1u << i;
+		}
+		else {
+			diff &= ~(1ULL << i);		// Not enough, still compared to the value last reported
+		}
+	}
+	ref.hat = s->hat;	// Exact fields, reported whenever they differ
+	ref.mode = s->mode;
+	ref.buttons = s->buttons;
+	return diff;
+}
+
+//////////////////////////// SUBSCRIPTIONS ////////////////////////////////
+// Subscribe to the fields of mask (bit i as X52StateDiff()), fn(user, state, fields) is called by Dispatch()
+// A callback may subscribe and unsubscribe, a new subscriber gets the next dispatch.
+int x52p_subs::Subscribe(unsigned long long fieldMask, X52Callback callback, void* callbackUser) {
+	fieldMask &= (1ULL << SubsFields) - 1;
+	if (fieldMask == 0 || callback == NULL) {
+		return -1;
+	}
+	int id = 0;
+	while (id < used && mask[id] != 0) {
+		++id;	// Free id of an unsubscriber first
+	}
+	if (id == SubsMax) {
+		return -1;
+	}
+	if (id == used) {
+		++used;
+	}
+	fn[id] = callback;
+	user[id] = callbackUser;
+	mask[id] = fieldMask;
+	stamp[id] = 0;		// Never a generation, not called by a dispatch already running
+	for (unsigned long long m = fieldMask; m != 0; m &= m - 1) {
+		int f = LowestBit(m);
+		members[f][memberCount[f]++] = (unsigned short)id;
+	}
+	++count;
+	return id;
+}
+
+void x52p_subs::Unsubscribe(int id) {
+	if (id < 0 || id >= used || mask[id] == 0) {
+		return;
+	}
+	for (unsigned long long m = mask[id]; m != 0; m &= m - 1) {
+		int f = LowestBit(m);
+		for (int i = 0; i < memberCount[f]; ++i) {
+			if (members[f][i] == id) {
+				members[f][i] = members[f][--memberCount[f]];	// Order of a field does not matter
+				break;
+			}
+		}
+	}
+	mask[id] = 0;
+	--count;
+}
+
+void x52p_subs::Reset() {
+	valid = 0;
+}
+
+int x52p_subs::GetCount() {
+	return count;
+}
+
+// Give the new state after a poll, the fields are its X52StateDiff() to the last one
+int x52p_subs::Dispatch(const X52State* s) {
+	unsigned long long fields;
+	if (!valid) {
+		fields = (1ULL << SubsFields) - 1;	// All fields, as x52p_gate
+		valid = 1;
+	}
+	else {
+		fields = X52StateDiff(&last, s);
+	}
+	last = *s;
+	return DispatchFields(s, fields);
+}
+
+// Call the subscribers of the fields: each changed field adds its members once (stamp of the dispatch), then
+// the callbacks run, so that they can change the subscriptions
+int x52p_subs::DispatchFields(const X52State* s, unsigned long long fields) {
+	X52P_TRACE_SCOPE("x52p_subs::Dispatch");
+	if (fields == 0) {
+		return 0;
+	}
+	if (++generation == 0) {
+		memset(stamp, 0, sizeof(stamp));	// Wrapped, the old stamps could match again
+		generation = 1;
+	}
+	int dueCount = 0;
+	for (unsigned long long m = fields & ((1ULL << SubsFields) - 1); m != 0; m &= m - 1) {
+		int f = LowestBit(m);
+		for (int i = 0; i < memberCount[f]; ++i) {
+			int id = members[f][i];
+			if (stamp[id] != generation) {
+				stamp[id] = generation;
+				due[dueCount++] = (unsigned short)id;
+			}
+		}
+	}
+	int called = 0;
+	for (int i = 0; i < dueCount; ++i) {
+		int id = due[i];
+		if (mask[id] != 0 && stamp[id] == generation) {	// Not unsubscribed (or replaced) by a callback before
+			fn[id](user[id], s, fields & mask[id]);
+			++called;
+		}
+	}
+	return called;
+}
+
+//////////////////////////// FUSION ///////////////////////////////////////
+// A step starts a generation: each reading thread reads its source once, then puts the state in result under
+// the lock. The step waits until all are done or skewBound passed, and takes every result newer than the one
+// it holds: a late thread finishes its read in the background and the next step takes it (older, as GetSkew()
+// shows), a slow source still comes in at its own rate.
+// Without threads the step reads the sources one after the other (the skew is the sum of the reads).
+
+x52p_fusion::~x52p_fusion() {
+	Stop();
+}
+
+int x52p_fusion::AddSource(x52p_ctrl* c) {
+	if (c == NULL || srcCount >= FusionMaxSources || threads > 0) {
+		return -1;
+	}
+	src[srcCount] = c;
+	held[srcCount] = c->GetCompactState();	// Rest state until the first read
+	heldTime[srcCount] = c->GetStateTime();
+	done[srcCount] = taken[srcCount] = 0;
+	skew[srcCount] = 0;
+	return srcCount++;
+}
+
+// Channels of the output vector in order, checked against the sources added so far
+int x52p_fusion::SetLayout(const FusionChannel* channels, int count) {
+	if (count < 0 || count > FusionMaxChannels) {
+		return 0;
+	}
+	for (int k = 0; k < count; ++k) {
+		const FusionChannel& ch = channels[k];
+		if (ch.source < 0 || ch.source >= srcCount ||
+			(ch.kind == FUSE_AXIS && (ch.index < 0 || ch.index >= AxisCount)) ||
+			(ch.kind == FUSE_BUTTON && (ch.index < 0 || ch.index >= ButtonCount)) ||
+			(ch.kind != FUSE_AXIS && ch.kind != FUSE_BUTTON && ch.kind != FUSE_HAT)) {
+			return 0;
+		}
+	}
+	memcpy(layout, channels, count * sizeof(FusionChannel));
+	chCount = count;
+	return 1;
+}
+
+// threaded: one reading thread per source, skewBound: seconds a step waits for the reads at most
+int x52p_fusion::Start(int threaded, double skewBound) {
+	Stop();
+	boundNs = (skewBound > 0) ? (long long)(skewBound * 1e9) : 0;
+	if (!threaded) {
+		return 1;
+	}
+	stop = false;
+	for (int i = 0; i < srcCount; ++i) {
+		src[i]->SetConfigReaders(CFG_READER_WORKER + 1);	// The thread reads the table too (watchdog)
+		workers[i] = std::thread(&x52p_fusion::Worker, this, i);
+	}
+	threads = srcCount;
+	return 1;
+}
+
+void x52p_fusion::Stop() {
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		stop = true;
+	}
+	wake.notify_all();
+	for (int i = 0; i < threads; ++i) {
+		workers[i].join();
+		src[i]->SetConfigReaders(CFG_READER_STEP + 1);
+	}
+	threads = 0;
+}
+
+void x52p_fusion::SetSimTime(double t) {
+	std::lock_guard<std::mutex> guard(lock);
+	simTime = t;	// Given to the sources by the reads of the next step
+}
+
+// One read of source i, by its thread (CFG_READER_WORKER) or by the step
+void x52p_fusion::Read(int i, int reader, X52State* s, long long* time) {
+	src[i]->ReadState(reader);
+	*s = src[i]->GetCompactState();
+	*time = src[i]->GetStateTime();
+}
+
+void x52p_fusion::Worker(int i) {
+	unsigned int seen = 0;
+	for (;;) {
+		double t;
+		{
+			std::unique_lock<std::mutex> guard(lock);
+			wake.wait(guard, [&] { return stop || generation != seen; });
+			if (stop) {
+				return;
+			}
+			seen = generation;
+			t = simTime;
+		}
+		src[i]->SetSimTime(t);
+		X52State s;
+		long long time;
+		Read(i, CFG_READER_WORKER, &s, &time);
+		std::lock_guard<std::mutex> guard(lock);
+		result[i] = s;		// Copied under the lock, the step may take it at any time
+		resultTime[i] = time;
+		done[i] = seen;
+		if (seen == generation && --remaining == 0) {
+			doneWake.notify_one();
+		}
+	}
+}
+
+int x52p_fusion::Step(double* out) {
+	X52P_TRACE_SCOPE("x52p_fusion::Step");
+	if (srcCount == 0) {
+		return 0;
+	}
+	int fresh = 0;
+	if (threads > 0) {
+		for (int i = 0; i < srcCount; ++i) {
+			src[i]->PassConfig(CFG_READER_STEP);	// The step reads no source itself, it passes here
+		}
+		std::unique_lock<std::mutex> guard(lock);
+		++generation;
+		remaining = threads;
+		wake.notify_all();
+		doneWake.wait_for(guard, std::chrono::nanoseconds(boundNs), [&] { return remaining == 0; });
+		for (int i = 0; i < srcCount; ++i) {
+			if (done[i] != taken[i]) {		// Newer than held, of this step or a late one
+				held[i] = result[i];
+				heldTime[i] = resultTime[i];
+				taken[i] = done[i];
+			}
+			fresh += (done[i] == generation);
+		}
+	}
+	else {
+		for (int i = 0; i < srcCount; ++i) {
+			src[i]->SetSimTime(simTime);
+			Read(i, CFG_READER_STEP, &held[i], &heldTime[i]);
+		}
+		fresh = srcCount;
+	}
+
+	long long newest = heldTime[0];
+	for (int i = 1; i < srcCount; ++i) {
+		newest = (heldTime[i] > newest) ? heldTime[i] : newest;
+	}
+	double axes[FusionMaxSources][AxisCount];
+	for (int i = 0; i < srcCount; ++i) {
+		skew[i] = (newest - heldTime[i]) * 1e-9;
+		src[i]->NormalizeAxes(&held[i], axes[i]);	// With the configuration of that source
+	}
+	for (int k = 0; k < chCount; ++k) {
+		const FusionChannel& ch = layout[k];
+		const X52State& s = held[ch.source];
+		switch (ch.kind) {
+		case FUSE_AXIS:
+			out[k] = axes[ch.source][ch.index] * ch.gain;
+			break;
+		case FUSE_BUTTON:
+			out[k] = (s.buttons >> ch.index & 1) ? ch.gain : 0;
+			break;
+		default:
+			out[k] = X52PovDeg(&s);
+			break;
+		}
+	}
+	return fresh;
+}
+
+double x52p_fusion::GetSkew(int source) {
+	return (source >= 0 && source < srcCount) ? skew[source] : 0;
+}
+
+int x52p_fusion::GetChannelNum() {
+	return chCount;
+}
+
+int x52p_fusion::GetSourceNum() {
+	return srcCount;
+}
+
+//////////////////////////// SPECTRUM /////////////////////////////////////
+// A Goertzel filter per DFT bin k of the band gives |X(k)|^2 of the window after window samples:
+//	s = x + 2 cos(2 pi k / N) s1 - s2, then |X(k)|^2 = s1^2 + s2^2 - 2 cos(2 pi k / N) s1 s2
+// With the Hann window w: amplitude of a sine on bin k = 2 |X(k)| / sum(w), power in the band (mean square)
+// = 2 sum |X(k)|^2 / (N sum(w^2)) (Parseval, the window leaks a sine into about 1.5 bins, counted once).
+// The dominant frequency is refined between the bins with a parabola through the peak and its neighbours,
+// its amplitude corrected by the response of the window at that offset.
+
+x52p_spectrum::~x52p_spectrum() {
+	delete[] hann;
+}
+
+// rate: samples per second, window: samples per window (resolution rate / window), band fLo to fHi (Hz)
+// At most SpectrumMaxBins bins, the band is cut above them
+int x52p_spectrum::Configure(double sampleRate, int windowSize, double fLo, double fHi) {
+	const double twoPi = 6.283185307179586;
+	delete[] hann;
+	hann = NULL;
+	bins = 0;
+	if (sampleRate <= 0 || windowSize < 16) {
+		return 0;
+	}
+	rate = sampleRate;
+	window = windowSize;
+	firstBin = (int)ceil(fLo * window / rate);
+	if (firstBin < 1) {
+		firstBin = 1;	// No DC
+	}
+	int lastBin = (int)floor(fHi * window / rate);
+	if (lastBin > window / 2 - 1) {
+		lastBin = window / 2 - 1;
+	}
+	bins = lastBin - firstBin + 1;
+	if (bins > SpectrumMaxBins) {
+		bins = SpectrumMaxBins;
+	}
+	if (bins <= 0) {
+		bins = 0;
+		return 0;
+	}
+	for (int k = 0; k < bins; ++k) {
+		coef[k] = 2 * cos(twoPi * (firstBin + k) / window);
+	}
+	hann = new double[window];
+	sumW = sumW2 = 0;
+	for (int i = 0; i < window; ++i) {
+		hann[i] = 0.5 - 0.5 * cos(twoPi * i / window);	// Periodic Hann
+		sumW += hann[i];
+		sumW2 += hann[i] * hann[i];
+	}
+	memset(s1, 0, sizeof(s1));
+	memset(s2, 0, sizeof(s2));
+	pos[0] = 0;
+	pos[1] = -(window / 2);		// The 2nd window starts half a window later
+	memset(&result, 0, sizeof(result));
+	return 1;
+}
+
+// One sample of each axis, the filters of both banks run, returns 1 if a window ended
+int x52p_spectrum::Push(const double x[SpectrumAxes], long long time) {
+	int ended = 0;
+	for (int b = 0; b < 2; ++b) {
+		if (pos[b] < 0) {
+			++pos[b];
+			continue;
+		}
+		double w = hann[pos[b]];
+		for (int a = 0; a < SpectrumAxes; ++a) {
+			double xw = x[a] * w;
+			double* p1 = s1[b][a];
+			double* p2 = s2[b][a];
+			for (int k = 0; k < bins; ++k) {	// Independent bins, vectorized by the compiler
+				double s = xw + coef[k] * p1[k] - p2[k];
+				p2[k] = p1[k];
+				p1[k] = s;
+			}
+		}
+		if (++pos[b] == window) {
+			Finish(b, time);
+			pos[b] = 0;
+			ended = 1;
+		}
+	}
+	return ended;
+}
+
+// Result of a window of a bank, then its filters start again
+void x52p_spectrum::Finish(int b, long long time) {
+	for (int a = 0; a < SpectrumAxes; ++a) {
+		double mag2[SpectrumMaxBins];
+		double total = 0;
+		int peak = 0;
+		for (int k = 0; k < bins; ++k) {
+			double p1 = s1[b][a][k], p2 = s2[b][a][k];
+			mag2[k] = p1 * p1 + p2 * p2 - coef[k] * p1 * p2;
+			total += mag2[k];
+			if (mag2[k] > mag2[peak]) {
+				peak = k;
+			}
+		}
+		double delta = 0;
+		if (peak > 0 && peak < bins - 1) {
+			double l = sqrt(mag2[peak - 1]), c = sqrt(mag2[peak]), r = sqrt(mag2[peak + 1]);
+			double d = l - 2 * c + r;
+			delta = (d < 0) ? 0.5 * (l - r) / d : 0;
+		}
+		result.power[a] = 2 * total / (window * sumW2);
+		result.freq[a] = (firstBin + peak + delta) * rate / window;
+		double x = 3.141592653589793 * delta;	// Hann response delta bins off the sine (scalloping)
+		double gain = (delta != 0) ? sin(x) / x / (1 - delta * delta) : 1;
+		result.amp[a] = 2 * sqrt(mag2[peak]) / sumW / gain;
+		memset(s1[b][a], 0, sizeof(s1[b][a]));
+		memset(s2[b][a], 0, sizeof(s2[b][a]));
+	}
+	result.time = time;
+	++result.windows;
+}
+
+const X52Spectrum& x52p_spectrum::GetResult() {
+	return result;
+}
+
+int x52p_spectrum::GetBinCount() {
+	return bins;
+}
+
+//////////////////////////// SCENARIO /////////////////////////////////////
+// Each sample is computed from the segments active at t, nothing is kept between the samples except the
+// cursor of each target (where its last segment was found). Noise and storms hash the seed, the target,
+// and the index of the draw, so any time gives the same value without running through the times before.
+
+static const char* const scenarioAxes[AxisCount] = { "x", "y", "z", "rx", "ry", "rz", "slider" };
+static const unsigned short scenarioRest[AxisCount] = { 32767, 32767, 65535, 0, 0, 32767, 0 };	// Stick released
+
+// Waveforms, their target kind (0 axis, 1 button, 2 hat, 3 mode, 4 device) and number of parameters
+struct ScenarioWaveInfo { const char* name; int kind; int params; int optional; };
+static const ScenarioWaveInfo scenarioWaves[] = {
+	{ "const", 0, 1, 0 }, { "ramp", 0, 2, 0 }, { "step", 0, 3, 0 }, { "sine", 0, 3, 0 },
+	{ "sweep", 0, 4, 0 }, { "noise", 0, 3, 1 }, { "hold", 1, 0, 0 }, { "pulse", 1, 2, 0 },
+	{ "storm", 1, 1, 0 }, { "dir", 2, 1, 0 }, { "rotate", 2, 1, 0 }, { "freeze", 4, 0, 0 }, { "error", 4, 0, 0 }
+};
+
+// Parse the script, returns 1 if loaded, 0 with GetError() telling the line otherwise (nothing is kept)
+int x52p_scenario::Load(const char* script) {
+	segCount = 0;
+	used = 0;
+	seed = 0;
+	duration = 0;
+	error[0] = '\0';
+
+	int lineNo = 0;
+	const char* p = script;
+	while (*p != '\0') {
+		++lineNo;
+		char line[256];
+		int n = 0;
+		while (*p != '\0' && *p != '\n') {
+			if (n < (int)sizeof(line) - 1 && *p != '\r') {
+				line[n++] = *p;
+			}
+			++p;
+		}
+		if (*p == '\n') {
+			++p;
+		}
+		line[n] = '\0';
+		char* hash = strchr(line, '#');
+		if (hash != NULL) {
+			*hash = '\0';
+		}
+
+		// Tokens: start end target [N] wave params...
+		char* tok[10];
+		int ntok = 0;
+		for (char* t = strtok(line, " \t"); t != NULL && ntok < 10; t = strtok(NULL, " \t")) {
+			tok[ntok++] = t;
+		}
+		if (ntok == 0) {
+			continue;
+		}
+		if (strcmp(tok[0], "seed") == 0 && ntok == 2) {
+			seed = strtoull(tok[1], NULL, 10);
+			continue;
+		}
+
+		ScenarioSegment seg = { 0 };
+		int kind = -1, at = 2;
+		char* end;
+		seg.start = strtod(tok[0], &end);
+		if (ntok < 4 || *end != '\0' || (seg.end = strtod(tok[1], &end), *end != '\0') || seg.end < seg.start) {
+			snprintf(error, sizeof(error), "Scenario line %d: expected start end target waveform ...", lineNo);
+			return (segCount = 0);
+		}
+		for (int i = 0; i < AxisCount; ++i) {
+			if (strcmp(tok[at], scenarioAxes[i]) == 0) {
+				seg.target = i;
+				kind = 0;
+			}
+		}
+		if (strcmp(tok[at], "hat") == 0) {
+			seg.target = X52FieldHat;
+			kind = 2;
+		}
+		else if (strcmp(tok[at], "mode") == 0) {
+			seg.target = X52FieldMode;
+			kind = 3;
+		}
+		else if (strcmp(tok[at], "device") == 0) {
+			seg.target = ScenarioDevice;
+			kind = 4;
+		}
+		else if (strcmp(tok[at], "button") == 0 && ntok > at + 1) {
+			int b = atoi(tok[++at]);
+			if (b >= 0 && b < ButtonCount) {
+				seg.target = X52FieldButton0 + b;
+				kind = 1;
+			}
+		}
+		++at;
+		if (kind < 0 || at >= ntok) {
+			snprintf(error, sizeof(error), "Scenario line %d: unknown target", lineNo);
+			return (segCount = 0);
+		}
+
+		seg.wave = -1;
+		if (kind == 3) {
+			seg.wave = WAVE_CONST;	// "mode 2": the value only, no waveform name
+			--at;
+		}
+		for (int w = 0; w < (int)(sizeof(scenarioWaves) / sizeof(scenarioWaves[0])) && kind != 3; ++w) {
+			if (strcmp(tok[at], scenarioWaves[w].name) == 0 && scenarioWaves[w].kind == kind) {
+				seg.wave = w;
+			}
+		}
+		int params = ntok - at - 1;
+		if (seg.wave < 0 || params > scenarioWaves[seg.wave].params ||
+			params < scenarioWaves[seg.wave].params - scenarioWaves[seg.wave].optional) {
+			snprintf(error, sizeof(error), "Scenario line %d: unknown waveform or wrong number of parameters", lineNo);
+			return (segCount = 0);
+		}
+		for (int i = 0; i < params; ++i) {
+			seg.p[i] = strtod(tok[at + 1 + i], &end);
+			if (*end != '\0') {
+				snprintf(error, sizeof(error), "Scenario line %d: parameter %d is not a number", lineNo, i + 1);
+				return (segCount = 0);
+			}
+		}
+		if (seg.wave == WAVE_NOISE && params == 2) {
+			seg.p[2] = 1000;	// New noise value every ms by default
+		}
+		if ((seg.wave == WAVE_PULSE && seg.p[0] <= 0) || ((seg.wave == WAVE_STORM || seg.wave == WAVE_NOISE) && seg.p[seg.wave == WAVE_NOISE ? 2 : 0] <= 0)) {
+			snprintf(error, sizeof(error), "Scenario line %d: the period or rate must be positive", lineNo);
+			return (segCount = 0);
+		}
+		if (segCount >= ScenarioMaxSegments) {
+			snprintf(error, sizeof(error), "Scenario line %d: more than %d segments", lineNo, ScenarioMaxSegments);
+			return (segCount = 0);
+		}
+		segs[segCount++] = seg;
+		if (seg.end > duration) {
+			duration = seg.end;
+		}
+	}
+
+	// Sort by target then start (insertion, in order of the script for equal starts), index per target
+	for (int i = 1; i < segCount; ++i) {
+		ScenarioSegment seg = segs[i];
+		int j = i - 1;
+		for (; j >= 0 && (segs[j].target > seg.target || (segs[j].target == seg.target && segs[j].start > seg.start)); --j) {
+			segs[j + 1] = segs[j];
+		}
+		segs[j + 1] = seg;
+	}
+	for (int t = 0, i = 0; t <= ScenarioTargets; ++t) {
+		while (i < segCount && segs[i].target < t) {
+			++i;
+		}
+		first[t] = i;
+	}
+	used = 0;
+	for (int t = 0; t < ScenarioTargets; ++t) {
+		cursor[t] = first[t];
+		if (first[t + 1] > first[t]) {
+			used |= 1ULL << t;
+		}
+	}
+	return 1;
+}
+
+// Load a script from a text file, returns 1 if loaded, 0 otherwise (see GetError())
+int x52p_scenario::LoadFile(const char* path) {
+	FILE* f = fopen(path, "rb");
+	if (f == NULL) {
+		snprintf(error, sizeof(error), "Scenario: cannot open %s", path);
+		return 0;
+	}
+	std::vector<char> text;
+	char buf[4096];
+	size_t n;
+	while ((n = fread(buf, 1, sizeof(buf), f)) > 0) {
+		text.insert(text.end(), buf, buf + n);
+	}
+	fclose(f);
+	text.push_back('\0');
+	return Load(&text[0]);
+}
+
+// Why the last Load() failed
+const char* x52p_scenario::GetError() {
+	return error;
+}
+
+// End of the last segment in seconds
+double x52p_scenario::GetDuration() {
+	return duration;
+}
+
+// Device fault at the time of the last Sample(), for GetState(): 0 none, WAVE_FREEZE, or WAVE_ERROR
+int x52p_scenario::GetFault() {
+	return fault;
+}
+
+// Noise in -1 to 1 for draw k of a target (splitmix64 of the seed, target and k)
+double x52p_scenario::Noise(int target, long long k) {
+	unsigned long long z = seed + (unsigned long long)target * 0x9E3779B97F4A7C15ULL + (unsigned long long)k * 0xBF58476D1CE4E5B9ULL;
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+	z ^= z >> 31;
+	return double(z >> 11) * (2.0 / 9007199254740992.0) - 1.0;	// 53 bits
+}
+
+// Value of a segment at t (within the segment)
+double x52p_scenario::Value(const ScenarioSegment& seg, double t) {
+	const double twoPi = 6.283185307179586;
+	double tau = t - seg.start, len = seg.end - seg.start;
+	switch (seg.wave) {
+	case WAVE_CONST:
+		return seg.p[0];
+	case WAVE_RAMP:
+		return (len > 0) ? seg.p[0] + (seg.p[1] - seg.p[0]) * tau / len : seg.p[1];
+	case WAVE_STEP:
+		return (tau < seg.p[2]) ? seg.p[0] : seg.p[1];
+	case WAVE_SINE:
+		return seg.p[0] + seg.p[1] * sin(twoPi * seg.p[2] * tau);
+	case WAVE_SWEEP:	// Linear chirp from f0 to f1 over the segment
+		return seg.p[0] + seg.p[1] * sin(twoPi * tau * (seg.p[2] + (len > 0 ? (seg.p[3] - seg.p[2]) * tau / (2 * len) : 0)));
+	case WAVE_NOISE:
+		return seg.p[0] + seg.p[1] * Noise(seg.target, (long long)floor(t * seg.p[2]));
+	case WAVE_HOLD:
+		return 1;
+	case WAVE_PULSE:
+		return (fmod(tau, seg.p[0]) < seg.p[1] * seg.p[0]) ? 1 : 0;
+	case WAVE_STORM:
+		return (Noise(seg.target, (long long)floor(tau * seg.p[0])) > 0) ? 1 : 0;
+	case WAVE_DIR:
+		return seg.p[0];
+	case WAVE_ROTATE:
+		return (long long)floor(tau * seg.p[0]) % 8;
+	case WAVE_FREEZE:
+	case WAVE_ERROR:
+		return seg.wave;
+	}
+	return 0;
+}
+
+// The state at t (seconds), any order of t works, in order is the fastest
+void x52p_scenario::Sample(double t, X52State* out) {
+	double v[ScenarioTargets];
+	unsigned long long active = 0;	// Target has a segment at t
+	for (unsigned long long left = used; left != 0; left &= left - 1) {
+		int target = LowestBit(left);
+		int lo = first[target], hi = first[target + 1];
+		// Last segment starting at or before t, from the cursor of the last sample
+		int i = cursor[target];
+		while (i + 1 < hi && segs[i + 1].start <= t) {
+			++i;
+		}
+		while (i > lo && segs[i].start > t) {
+			--i;
+		}
+		cursor[target] = i;
+		for (; i >= lo && segs[i].start <= t; --i) {	// Overlaps: the latest start still running
+			if (t < segs[i].end) {
+				v[target] = Value(segs[i], t);
+				active |= 1ULL << target;
+				break;
+			}
+		}
+	}
+
+	for (int a = 0; a < AxisCount; ++a) {
+		double x = (active >> a & 1) ? v[a] : scenarioRest[a];
+		out->axes[a] = (unsigned short)(x < 0 ? 0 : (x > 65535 ? 65535 : x + 0.5));
+	}
+	int hat = (active >> X52FieldHat & 1) ? (int)v[X52FieldHat] : -1;
+	out->hat = (hat >= 0 && hat < 8) ? (unsigned char)hat : X52HatCentered;
+	out->buttons = 0;
+	for (unsigned long long bits = (active >> X52FieldButton0) & X52ButtonBits; bits != 0; bits &= bits - 1) {
+		int b = LowestBit(bits);
+		if (v[X52FieldButton0 + b] != 0) {
+			out->buttons |= 1ULL << b;
+		}
+	}
+	int mode = (active >> X52FieldMode & 1) ? (int)v[X52FieldMode] : 0;
+	if (mode >= 1 && mode <= 3) {
+		out->buttons |= 1ULL << (X52ModeButton + mode - 1);
+	}
+	unsigned int modes = (unsigned int)(out->buttons >> X52ModeButton) & 7;	// As X52StateFromDI()
+	out->mode = (modes & 1) ? 1 : (modes & 2) ? 2 : (modes & 4) ? 3 : 0;
+	fault = (active >> ScenarioDevice & 1) ? (int)v[ScenarioDevice] : 0;
+}
+
+// The state at t as DirectInput gives it
+void x52p_scenario::SampleDI(double t, DIJOYSTATE2* out) {
+	X52State s;
+	Sample(t, &s);
+	X52StateToDI(&s, out);
+}
+
+//////////////////////////// CONFIGURATION ////////////////////////////////
+// A text file, one setting per line, # starts a comment:
+//		axis <x|y|z|rx|ry|rz|slider> <centered|inverted|throttle|linear> <scale> <deadzone>
+//			centered: (v - scale) / scale, -1 to 1 with scale the center; inverted: the same, upside down
+//			throttle: (scale - v) / scale, 0 to 1 with scale the full range; linear: v / scale, 0 to 1
+//			deadzone in raw units (0 to 65535), 0 <= deadzone < scale; axes not listed keep the built-in setting
+//		led <button 0-38> <LED red ID> <red|green|yellow>
+//			the LED lit while the button is pressed (IDs at the end of x52p_ctrl.h: 1, 3, ... 17, or 0 and 19
+//			that have one color); the first led line replaces the built-in buttons to LEDs
+//		failsafe <x|y|z|rx|ry|rz|slider> <hold|raw value 0-65535>
+//			the axis while the device is stalled (see WATCHDOG): held at the last good value, or this value
+// The file is compiled into an X52Config, the steps only read it through the cfg pointer: no lock, no allocation.
+// A new table is swapped in whole, the old one is freed once every reader passed ReadState() after the swap
+// (a reader never holds the table across ReadState()). Each reader has its own epoch: the reading threads of
+// x52p_fusion read the watchdog failsafe while its step normalizes the axes, one epoch for both would free the
+// table under the other thread. A file with an error leaves the table in use as it is.
+
+static const char* const configModes[] = { "centered", "inverted", "throttle", "linear" };
+static const char* const configColors[] = { "off", "red", "green", "yellow" };	// LEDColor
+const DWORD ConfigPollMs = 500;		// Check of the file without change notification (network folders)
+const int ConfigMaxBytes = 65536;
+
+// The built-in configuration, as the constants in x52p_ctrl.h and the LEDs of x52p_ctrl_SFun_wInput
+static X52Config MakeDefaultConfig() {
+	X52Config def;
+	X52AxisConfig centered = { AXIS_CENTERED, thrs, deadzone }, inverted = { AXIS_INVERTED, thrs, deadzone };
+	X52AxisConfig throttle = { AXIS_THROTTLE, thrsZ, deadzone }, linear = { AXIS_LINEAR, thrsZ, 0 };
+	X52AxisConfig axes[AxisCount] = { centered, inverted, throttle, linear, linear, centered, linear };
+	memcpy(def.axes, axes, sizeof(axes));
+	memset(def.ledOf, -1, sizeof(def.ledOf));
+	memset(def.colorOf, 0, sizeof(def.colorOf));
+	int failsafe[AxisCount] = { 32767, 32767, -1, -1, -1, 32767, -1 };	// Stick centered, throttle held
+	memcpy(def.failsafe, failsafe, sizeof(failsafe));
+	static const int leds[][3] = { {2, 1, LED_YELLOW}, {3, 3, LED_RED}, {6, 5, LED_YELLOW}, {7, 7, LED_RED},
+		{19, 15, LED_YELLOW}, {20, 15, LED_YELLOW}, {21, 15, LED_RED}, {22, 15, LED_YELLOW} };
+	for (int i = 0; i < 8; ++i) {
+		def.ledOf[leds[i][0]] = (signed char)leds[i][1];
+		def.colorOf[leds[i][0]] = (unsigned char)leds[i][2];
+	}
+	return def;
+}
+
+const X52Config* X52DefaultConfig() {
+	static const X52Config def = MakeDefaultConfig();
+	return &def;
+}
+
+// Index of a word in a table, -1 if not there
+static int ConfigWord(const char* word, const char* const* table, int count) {
+	for (int i = 0; i < count; ++i) {
+		if (strcmp(word, table[i]) == 0) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+// Compile a configuration text, out is only written when it is valid. Returns 1, or 0 with the error
+int X52ParseConfig(const char* text, X52Config* out, char* error, int errorSize) {
+	X52Config c = *X52DefaultConfig();
+	int ledLines = 0, lineNo = 0;
+	const char* p = text;
+	while (*p != '\0') {
+		++lineNo;
+		char line[256];
+		int n = 0;
+		while (*p != '\0' && *p != '\n') {
+			if (n < (int)sizeof(line) - 1 && *p != '\r') {
+				line[n++] = *p;
+			}
+			++p;
+		}
+		if (*p == '\n') {
+			++p;
+		}
+		line[n] = '\0';
+		char* hash = strchr(line, '#');
+		if (hash != NULL) {
+			*hash = '\0';
+		}
+
+		// Tokens, not strtok: the watcher thread parses while the step may load a scenario
+		char* tok[6];
+		int ntok = 0;
+		for (char* q = line; *q != '\0' && ntok < 6; ) {
+			while (*q == ' ' || *q == '\t') {
+				*q++ = '\0';
+			}
+			if (*q != '\0') {
+				tok[ntok++] = q;
+			}
+			while (*q != '\0' && *q != ' ' && *q != '\t') {
+				++q;
+			}
+		}
+		if (ntok == 0) {
+			continue;
+		}
+
+		char* end1;
+		char* end2;
+		if (strcmp(tok[0], "axis") == 0 && ntok == 5) {
+			int axis = ConfigWord(tok[1], scenarioAxes, AxisCount);
+			int mode = ConfigWord(tok[2], configModes, 4);
+			double scale = strtod(tok[3], &end1), dz = strtod(tok[4], &end2);
+			if (axis < 0 || mode < 0 || *end1 != '\0' || *end2 != '\0') {
+				snprintf(error, errorSize, "Config line %d: expected axis <x|y|z|rx|ry|rz|slider> <mode> <scale> <deadzone>", lineNo);
+				return 0;
+			}
+			if (!(scale > 0 && scale <= 65535) || !(dz >= 0 && dz < scale)) {
+				snprintf(error, errorSize, "Config line %d: scale must be 0 to 65535, deadzone 0 to the scale", lineNo);
+				return 0;
+			}
+			X52AxisConfig a = { mode, scale, dz };
+			c.axes[axis] = a;
+		}
+		else if (strcmp(tok[0], "led") == 0 && ntok == 4) {
+			long b = strtol(tok[1], &end1, 10), led = strtol(tok[2], &end2, 10);
+			int color = ConfigWord(tok[3], configColors, 4);
+			if (*end1 != '\0' || b < 0 || b >= ButtonCount) {
+				snprintf(error, errorSize, "Config line %d: button must be 0 to %d", lineNo, ButtonCount - 1);
+				return 0;
+			}
+			if (*end2 != '\0' || led < 0 || led >= LEDCount || (led % 2 == 0 && led != 0) || color <= LED_OFF) {
+				snprintf(error, errorSize, "Config line %d: LED must be 0, 19, or a red ID 1, 3, ... 17, then red, green or yellow", lineNo);
+				return 0;
+			}
+			if (ledLines++ == 0) {
+				memset(c.ledOf, -1, sizeof(c.ledOf));	// The file gives all the LEDs
+			}
+			c.ledOf[b] = (signed char)led;
+			c.colorOf[b] = (unsigned char)color;
+		}
+		else if (strcmp(tok[0], "failsafe") == 0 && ntok == 3) {
+			int axis = ConfigWord(tok[1], scenarioAxes, AxisCount);
+			int hold = (strcmp(tok[2], "hold") == 0);
+			long raw = hold ? -1 : strtol(tok[2], &end1, 10);
+			if (axis < 0 || (!hold && (*end1 != '\0' || raw < 0 || raw > 65535))) {
+				snprintf(error, errorSize, "Config line %d: expected failsafe <x|y|z|rx|ry|rz|slider> <hold|0-65535>", lineNo);
+				return 0;
+			}
+			c.failsafe[axis] = (int)raw;
+		}
+		else {
+			snprintf(error, errorSize, "Config line %d: expected axis, led or failsafe", lineNo);
+			return 0;
+		}
+	}
+	*out = c;
+	return 1;
+}
+
+// Normalized value of one axis with a configuration
+double X52ConfigAxis(const X52Config* cfg, const X52State* s, int axis) {
+	const X52AxisConfig& a = cfg->axes[axis];
+	double v = s->axes[axis];
+	switch (a.mode) {
+	case AXIS_CENTERED:
+		if (v > a.scale + a.deadzone || v < a.scale - a.deadzone) {
+			return (v - a.scale) / a.scale;
+		}
+		return 0.0f;
+	case AXIS_INVERTED:		// Y, up is positive
+		if (v > a.scale + a.deadzone || v < a.scale - a.deadzone) {
+			return (a.scale - v) / a.scale;
+		}
+		return 0.0f;
+	case AXIS_THROTTLE: {	// Z, modified correctly, Jan 2023
+		double tmp = a.scale - v;	// Set to 0 to scale
+		if (tmp > a.deadzone) {
+			return tmp / a.scale;
+		}
+		return 0.0f;
+	}
+	default:				// RX, RY, slider
+		if (v > a.deadzone) {
+			return v / a.scale;
+		}
+		return 0.0f;
+	}
+}
+
+// Load a configuration file now (NULL for the built-in one), returns 1, or 0 and the table stays (rejected),
+// or -1 and the table stays until a step passed (the replaced tables are still held, see GetConfigError())
+int x52p_ctrl::LoadConfig(const char* path) {
+	return SwapConfig(path);
+}
+
+// Compile the file and swap it in. Returns 1, 0 if rejected, -1 if the old tables are still in use (try later)
+int x52p_ctrl::SwapConfig(const char* path) {
+	X52Config* next = NULL;
+	char error[160] = "";
+	if (path != NULL) {
+		FILE* f = fopen(path, "rb");
+		if (f == NULL) {
+			snprintf(error, sizeof(error), "Config: cannot open %s", path);
+		}
+		else {
+			std::vector<char> text(ConfigMaxBytes + 1);
+			size_t n = fread(&text[0], 1, ConfigMaxBytes + 1, f);
+			fclose(f);
+			if (n > (size_t)ConfigMaxBytes) {
+				snprintf(error, sizeof(error), "Config: %s is larger than %d bytes", path, ConfigMaxBytes);
+			}
+			else {
+				text[n] = '\0';
+				X52Config parsed;
+				if (X52ParseConfig(&text[0], &parsed, error, sizeof(error))) {
+					next = new X52Config(parsed);
+				}
+			}
+		}
+		if (next == NULL) {
+			std::lock_guard<std::mutex> lock(cfgLock);
+			snprintf(cfgError, sizeof(cfgError), "%s", error);
+			++cfgRejects;
+			return 0;
+		}
+	}
+
+	std::lock_guard<std::mutex> lock(cfgLock);
+	FreeRetiredConfigs(0);
+	if (cfgRetiredCount == 8) {
+		delete next;	// The step did not read since the last swaps (not running), not a reject of the file
+		snprintf(cfgError, sizeof(cfgError), "Config: previous tables still in use, retry");
+		return -1;
+	}
+	const X52Config* old = cfg.exchange(next != NULL ? next : X52DefaultConfig(), std::memory_order_acq_rel);
+	unsigned int epoch = cfgEpoch.fetch_add(1, std::memory_order_acq_rel) + 1;
+	if (old != X52DefaultConfig()) {
+		cfgRetired[cfgRetiredCount] = old;
+		cfgRetiredEpoch[cfgRetiredCount++] = epoch;	// In use until the step reads with this epoch
+	}
+	cfgError[0] = '\0';
+	return 1;
+}
+
+// Free the replaced tables no reader can use anymore (all: no reader anymore), with cfgLock held
+void x52p_ctrl::FreeRetiredConfigs(int all) {
+	unsigned int seen[CFG_READERS];
+	for (int r = 0; r < cfgReaders; ++r) {
+		seen[r] = cfgSeen[r].load(std::memory_order_acquire);
+	}
+	int kept = 0;
+	for (int i = 0; i < cfgRetiredCount; ++i) {
+		int passed = 1;
+		for (int r = 0; r < cfgReaders; ++r) {
+			passed &= (int)(seen[r] - cfgRetiredEpoch[i]) >= 0;
+		}
+		if (all || passed) {
+			delete cfgRetired[i];
+		}
+		else {
+			cfgRetired[kept] = cfgRetired[i];
+			cfgRetiredEpoch[kept++] = cfgRetiredEpoch[i];
+		}
+	}
+	cfgRetiredCount = kept;
+}
+
+// Load a configuration file and reload it when it changes, returns 0 (no watch) if the first load fails,
+// -1 if the tables are still in use (the watcher loads it once the step passed)
+int x52p_ctrl::WatchConfig(const char* path) {
+	StopConfigWatch();
+	int loaded = LoadConfig(path);
+	if (loaded == 0) {
+		return 0;
+	}
+	snprintf(cfgPath, sizeof(cfgPath), "%s", path);
+	cfgStopEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+	cfgThread = std::thread(&x52p_ctrl::ConfigWatchThread, this, (int)(loaded < 0));
+	return loaded;
+}
+
+void x52p_ctrl::StopConfigWatch() {
+	if (cfgThread.joinable()) {
+		SetEvent(cfgStopEvent);
+		cfgThread.join();
+		CloseHandle(cfgStopEvent);
+		cfgStopEvent = NULL;
+	}
+}
+
+// Readers 0 to count - 1 (X52ConfigReader) read the table, from their own thread each
+// A reader added passes now: it loads the table after this call, never one already replaced.
+void x52p_ctrl::SetConfigReaders(int count) {
+	std::lock_guard<std::mutex> lock(cfgLock);
+	count = (count < 1) ? 1 : (count > CFG_READERS) ? CFG_READERS : count;
+	for (int r = cfgReaders; r < count; ++r) {
+		PassConfig(r);
+	}
+	cfgReaders = count;
+}
+
+// Called by a reader between two uses of the table, at a point it holds none
+void x52p_ctrl::PassConfig(int reader) {
+	cfgSeen[reader].store(cfgEpoch.load(std::memory_order_acquire), std::memory_order_release);
+}
+
+// Times the configuration was swapped in
+int x52p_ctrl::GetConfigVersion() {
+	return (int)cfgEpoch.load(std::memory_order_relaxed);
+}
+
+// Files rejected so far (the table in use stayed)
+int x52p_ctrl::GetConfigRejects() {
+	return cfgRejects.load(std::memory_order_relaxed);
+}
+
+// Why the last file was rejected or is not loaded yet, empty after a good one
+void x52p_ctrl::GetConfigError(char* text, int size) {
+	std::lock_guard<std::mutex> lock(cfgLock);
+	snprintf(text, size, "%s", cfgError);
+}
+
+// Watcher: wakes on a change in the folder of the file (or every ConfigPollMs), reloads when the time or size changed
+void x52p_ctrl::ConfigWatchThread(int retry) {
+	char dir[260];
+	snprintf(dir, sizeof(dir), "%s", cfgPath);
+	char* slash = strrchr(dir, '\\');
+	if (slash == NULL || (strrchr(dir, '/') != NULL && strrchr(dir, '/') > slash)) {
+		slash = strrchr(dir, '/');
+	}
+	if (slash != NULL) {
+		*slash = '\0';
+	}
+	else {
+		snprintf(dir, sizeof(dir), ".");
+	}
+	HANDLE change = FindFirstChangeNotificationA(dir, FALSE, FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_SIZE);
+	HANDLE waits[2] = { cfgStopEvent, change };
+
+	WIN32_FILE_ATTRIBUTE_DATA last = { 0 }, now;
+	GetFileAttributesExA(cfgPath, GetFileExInfoStandard, &last);	// Loaded by WatchConfig(), or retried
+	for (;;) {
+		DWORD r = (change != INVALID_HANDLE_VALUE) ? WaitForMultipleObjects(2, waits, FALSE, ConfigPollMs) : WaitForSingleObject(cfgStopEvent, ConfigPollMs);
+		if (r == WAIT_OBJECT_0) {
+			break;
+		}
+		if (r == WAIT_OBJECT_0 + 1) {
+			FindNextChangeNotification(change);	// Any file of the folder, compared below
+		}
+		if (!GetFileAttributesExA(cfgPath, GetFileExInfoStandard, &now)) {
+			continue;	// Being replaced by the editor
+		}
+		if (!retry && now.nFileSizeLow == last.nFileSizeLow && now.nFileSizeHigh == last.nFileSizeHigh &&
+			memcmp(&now.ftLastWriteTime, &last.ftLastWriteTime, sizeof(FILETIME)) == 0) {
+			continue;
+		}
+		last = now;
+		retry = (SwapConfig(cfgPath) < 0);
+	}
+	if (change != INVALID_HANDLE_VALUE) {
+		FindCloseChangeNotification(change);
+	}
+}
+
+// LEDs of the buttons with the configuration: the colors of the pressed buttons on one LED add up,
+// the LEDs of the fire buttons, toggles, and POV 2 (and the ones in the configuration) are off otherwise
+void x52p_ctrl::ShowButtonLEDs() {
+	X52P_TRACE_SCOPE("ShowButtonLEDs");
+	const X52Config* c = cfg.load(std::memory_order_acquire);
+	int color[LEDCount] = { 0 };
+	unsigned int shown = 0xAAAA;	// Red IDs 1 to 15
+	for (int i = 0; i < ButtonCount; ++i) {
+		int led = c->ledOf[i];
+		if (led >= 0) {
+			shown |= 1u << led;
+			if (cstate.buttons >> i & 1) {
+				color[led] |= c->colorOf[i];
+			}
+		}
+	}
+	for (int id = 0; id < LEDCount; ++id) {
+		if (!(shown >> id & 1)) {
+			continue;
+		}
+		if (id == 0 || id == 19) {
+			SetLed(id, color[id] != LED_OFF ? 1 : 0);	// One color only
+		}
+		else {
+			SetLed(id, (color[id] & LED_RED) ? 1 : 0);
+			SetLed(id + 1, (color[id] & LED_GREEN) ? 1 : 0);
+		}
+	}
+}
+
+//////////////////////////// OUTPUT SCHEDULER /////////////////////////////
+// Every LED and MFD line write goes through a slot (LEDs 0 to 19, then page * 3 + line of the MFD).
+// With a budget, the calls to DirectOutput are limited by a token bucket: a burst of changes waits in the
+// slots, a newer value replaces the waiting one, and the waiting slots are sent by priority when tokens come
+// back, at the next write or PumpOutputs(). Without a budget (default) every write is sent at once.
+// AddPage is not budgeted, it is needed before the strings of its page and happens at start only.
+// No DirectOutput call is made under outLock: the slots to send are made ready under the lock, and FlushOutputs()
+// copies their values and makes the calls after releasing it.
+
+// Set the budget: callsPerSecond DirectOutput calls on average, burst at once, 0 calls per second for no budget
+void x52p_ctrl::SetOutputBudget(double callsPerSecond, int burst) {
+	std::unique_lock<std::mutex> lock(outLock);
+	outRate = callsPerSecond > 0 ? callsPerSecond : 0;
+	outBurst = burst > 1 ? burst : 1;
+	outTokens = outBurst;
+	outRefill = x52p_now_ns();
+	PumpLocked(outRefill);	// Anything waiting can go now if the budget is larger or removed
+	FlushOutputs(lock);
+}
+
+// Set the priority of a LED by its red ID (as SetLEDPress*), e.g. OUT_PRIO_WARNING for warning lights
+// The green LED of the button gets the same priority. The LEDs are OUT_PRIO_MODE by default.
+void x52p_ctrl::SetLEDPriority(DWORD b_id, int priority) {
+	if (b_id >= (DWORD)LEDCount || priority < 0 || priority >= OUT_PRIO_COUNT) {
+		return;
+	}
+	std::lock_guard<std::mutex> lock(outLock);
+	for (DWORD id = b_id; id <= b_id + 1 && id < (DWORD)LEDCount; ++id) {
+		if (id != b_id && (b_id == 0 || b_id == 19)) {
+			break;	// Fire and throttle have one color
+		}
+		for (int p = 0; p < OUT_PRIO_COUNT; ++p) {
+			if (outPending[p] >> id & 1) {
+				outPending[p] &= ~(1u << id);	// Waiting: move to the new priority
+				outPending[priority] |= 1u << id;
+			}
+		}
+		outPrio[id] = priority;
+	}
+}
+
+// Method to send the waiting writes the budget allows now, call it every step
+// Nothing waiting (always the case without a budget): no clock read, cheap enough for every step
+void x52p_ctrl::PumpOutputs() {
+	X52P_TRACE_SCOPE("PumpOutputs");
+	std::unique_lock<std::mutex> lock(outLock);
+	unsigned int waiting = 0;
+	for (int p = 0; p < OUT_PRIO_COUNT; ++p) {
+		waiting |= outPending[p];
+	}
+	if (waiting != 0) {
+		PumpLocked(x52p_now_ns());
+		FlushOutputs(lock);
+	}
+}
+
+// Get the counters of the output scheduler
+void x52p_ctrl::GetOutputStats(OutputStats* stats) {
+	std::lock_guard<std::mutex> lock(outLock);
+	*stats = outStats;
+	stats->pending = 0;
+	for (int p = 0; p < OUT_PRIO_COUNT; ++p) {
+		unsigned int bits = outPending[p];
+		while (bits != 0) {
+			bits &= bits - 1;
+			++stats->pending;
+		}
+	}
+}
+
+// Ask for a slot to be sent with its newest value, with outLock held
+void x52p_ctrl::SubmitOutput(int slot) {
+	++outStats.submitted;
+	int prio = outPrio[slot];
+	if ((outPending[prio] | outReady) >> slot & 1) {
+		++outStats.coalesced;	// The waiting write sends the new value instead
+		return;
+	}
+	if (outRate == 0) {
+		ReadyOutput(slot);
+		return;
+	}
+	outPending[prio] |= 1u << slot;
+	PumpLocked(x52p_now_ns());
+	if (outPending[prio] >> slot & 1) {
+		++outStats.deferred;
+	}
+}
+
+// Make a slot ready for FlushOutputs() to send, with outLock held, returns 1 if a call will be made
+// Nothing is sent (nor counted) for an unplugged device, or a line of a page hidden while waiting: the page
+// callback sends the page when it is shown again
+int x52p_ctrl::ReadyOutput(int slot) {
+	if (DOdev == NULL || (slot >= LEDCount && mfdActive != (slot - LEDCount) / MFDLines)) {
+		return 0;
+	}
+	++outStats.sent;
+	outReady |= 1u << slot;
+	return 1;
+}
+
+// One DirectOutput call, copied out of its slot to be made without outLock
+struct OutWrite
+{
+	int led;		// 1 SetLed, 0 SetString
+	DWORD page;		// DirectOutput page
+	DWORD index;	// LED, or line of the MFD
+	DWORD value;	// LED on or off, or number of characters
+	wchar_t text[MFDChars + 1];
+};
+
+// Make the calls of the ready slots, with outLock held by lock, which is released during the calls
+// DirectOutput calls can be slow, and the library may call the page callback back (FlushMFDPage() takes outLock).
+// One thread sends at a time, so the device gets the values in order: the other threads leave their slots ready
+// and return, the sending thread takes them at its next round with their newest values.
+void x52p_ctrl::FlushOutputs(std::unique_lock<std::mutex>& lock) {
+	if (outSending) {
+		return;
+	}
+	outSending = true;
+	OutWrite writes[OutSlotCount];
+	while (outReady != 0) {
+		void* dev = DOdev;	// Again at every round: the device may have gone while the lock was released
+		if (dev == NULL) {
+			for (; outReady != 0; outReady &= outReady - 1) {
+				--outStats.sent;	// Counted by ReadyOutput(), not made
+			}
+			break;
+		}
+		int count = 0;
+		for (unsigned long slot; outReady != 0; outReady &= outReady - 1) {
+			_BitScanForward(&slot, outReady);
+			OutWrite* w = &writes[count++];
+			w->led = (slot < (unsigned long)LEDCount);
+			if (w->led) {
+				w->page = dwPage;
+				w->index = slot;
+				w->value = outLed[slot];
+				continue;
+			}
+			int page = (slot - LEDCount) / MFDLines, pos = (slot - LEDCount) % MFDLines;
+			w->page = dwPage + page;
+			w->index = pos;
+			w->value = mfdLength[page][pos];
+			wmemcpy(w->text, mfdText[page][pos], w->value + 1);
+		}
+
+		lock.unlock();
+		for (int i = 0; i < count; ++i) {
+			X52P_TRACE_SCOPE("DirectOutput write");
+			if (writes[i].led) {
+				DirectOutput_SetLed(dev, writes[i].page, writes[i].index, writes[i].value);
+			}
+			else {
+				DirectOutput_SetString(dev, writes[i].page, writes[i].index, writes[i].value, writes[i].text);
+			}
+		}
+		lock.lock();
+	}
+	outSending = false;
+}
+
+// Refill the tokens and make the waiting slots ready, highest priority first, with outLock held
+void x52p_ctrl::PumpLocked(long long now) {
+	if (outRate == 0) {
+		for (int p = 0; p < OUT_PRIO_COUNT; ++p) {	// No budget (anymore): everything goes
+			for (unsigned long slot; outPending[p] != 0; outPending[p] &= outPending[p] - 1) {
+				_BitScanForward(&slot, outPending[p]);
+				ReadyOutput(slot);
+			}
+		}
+		return;
+	}
+	outTokens += (now - outRefill) * 1e-9 * outRate;
+	outRefill = now;
+	if (outTokens > outBurst) {
+		outTokens = outBurst;
+	}
+	for (int p = 0; p < OUT_PRIO_COUNT && outTokens >= 1; ++p) {
+		while (outPending[p] != 0 && outTokens >= 1) {
+			unsigned long slot;
+			_BitScanForward(&slot, outPending[p]);
+			outPending[p] &= outPending[p] - 1;	// Out of the slot before sending, a newer value waits again
+			outTokens -= ReadyOutput(slot);		// A write not needed anymore costs nothing
+		}
+	}
+}
+
+//////////////////////////// LED ANIMATION ////////////////////////////////
+// The model sets a pattern per LED (steady, blink, alternate, flash) and the animation thread sends only the
+// transitions, at their time, whatever the step of the model. The transitions are in a timer wheel of
+// LEDWheelSlots slots of LEDWheelTickNs, the thread sleeps until the next slot with a LED in it.
+
+// Set the pattern of a LED by its red ID (as SetLEDPress*, or 0 fire and 19 throttle which have one color)
+// period in seconds: blink/alternate period (1/Hz), length of a flash. A flash goes back to the pattern before.
+// Setting the same pattern again does nothing, so it can be called every step. ANIM_NONE gives the LED back
+// to SetLEDPress*/SetLEDOff.
+void x52p_ctrl::SetLEDPattern(DWORD b_id, int pattern, int colorA, int colorB, double period) {
+	if (b_id >= (DWORD)LEDCount || (b_id % 2 == 0 && b_id != 0)) {
+		return;
+	}
+	long long periodNs = (long long)(period * 1e9);
+	if (periodNs < 2 * LEDWheelTickNs && (pattern == ANIM_BLINK || pattern == ANIM_ALTERNATE || pattern == ANIM_FLASH)) {
+		periodNs = 2 * LEDWheelTickNs;	// Faster than the wheel cannot be shown
+	}
+
+	std::lock_guard<std::mutex> lock(ledAnimLock);	// The thread changes the pattern at the end of a flash
+	LEDAnim& a = ledAnim[b_id];
+	if (a.pattern == pattern && a.colorA == colorA && a.colorB == colorB && a.periodNs == periodNs) {
+		return;	// Same pattern, nothing to do
+	}
+	UnscheduleLED(b_id);
+	if (pattern == ANIM_FLASH && a.pattern != ANIM_FLASH) {
+		a.prevPattern = a.pattern;	// Shown again after the flash
+		a.prevA = a.colorA;
+		a.prevB = a.colorB;
+		a.prevPeriodNs = a.periodNs;
+	}
+	a.pattern = pattern;
+	a.colorA = colorA;
+	a.colorB = colorB;
+	a.periodNs = periodNs;
+	a.phase = 0;
+
+	unsigned int bits = (b_id == 0 || b_id == 19) ? 1u << b_id : 3u << b_id;	// Red and green
+	if (pattern == ANIM_NONE) {
+		ledAnimMask &= ~bits;
+		return;
+	}
+	ledAnimMask |= bits;
+
+	ShowLEDColor(b_id, colorA);
+	if (pattern != ANIM_STEADY) {
+		a.deadline = x52p_now_ns() + (pattern == ANIM_FLASH ? periodNs : periodNs / 2);
+		ScheduleLED(b_id);
+		if (!ledThread.joinable()) {
+			ledStop = false;
+			ledThread = std::thread(&x52p_ctrl::LEDThread, this);
+		}
+		ledWake.notify_one();
+	}
+}
+
+// Show a color on a LED, with ledAnimLock held
+void x52p_ctrl::ShowLEDColor(int b_id, int color) {
+	if (b_id == 0 || b_id == 19) {
+		SendLed(b_id, color != LED_OFF ? 1 : 0);	// One color only
+	}
+	else {
+		SendLed(b_id, (color & LED_RED) ? 1 : 0);
+		SendLed(b_id + 1, (color & LED_GREEN) ? 1 : 0);
+	}
+}
+
+// Put a LED in the wheel slot of its deadline, with ledAnimLock held
+void x52p_ctrl::ScheduleLED(int b_id) {
+	int slot = int((ledAnim[b_id].deadline / LEDWheelTickNs) % LEDWheelSlots);
+	ledAnim[b_id].next = ledWheel[slot];
+	ledWheel[slot] = b_id;
+	ledAnim[b_id].scheduled = 1;
+}
+
+// Take a LED out of the wheel, with ledAnimLock held
+void x52p_ctrl::UnscheduleLED(int b_id) {
+	if (!ledAnim[b_id].scheduled) {
+		return;
+	}
+	int slot = int((ledAnim[b_id].deadline / LEDWheelTickNs) % LEDWheelSlots);
+	int* link = &ledWheel[slot];
+	while (*link != -1 && *link != b_id) {
+		link = &ledAnim[*link].next;
+	}
+	if (*link == b_id) {
+		*link = ledAnim[b_id].next;
+	}
+	ledAnim[b_id].scheduled = 0;
+}
+
+// Do the transition of a LED that is due, and schedule the next one, with ledAnimLock held
+// The next deadline follows the last one (not now), so a late wake-up does not shift the blinking
+void x52p_ctrl::AnimateLED(int b_id, long long now) {
+	X52P_TRACE_SCOPE("AnimateLED");
+	LEDAnim& a = ledAnim[b_id];
+	if (a.pattern == ANIM_FLASH) {
+		a.pattern = a.prevPattern;	// Back to the pattern before the flash
+		a.colorA = a.prevA;
+		a.colorB = a.prevB;
+		a.periodNs = a.prevPeriodNs;
+		a.phase = 0;
+		if (a.pattern == ANIM_NONE) {
+			ledAnimMask &= ~((b_id == 0 || b_id == 19) ? 1u << b_id : 3u << b_id);
+			ShowLEDColor(b_id, LED_OFF);
+			return;
+		}
+		ShowLEDColor(b_id, a.colorA);
+		if (a.pattern == ANIM_STEADY) {
+			return;
+		}
+		a.deadline = now + a.periodNs / 2;
+	}
+	else {
+		a.phase ^= 1;
+		ShowLEDColor(b_id, a.phase == 0 ? a.colorA : (a.pattern == ANIM_ALTERNATE ? a.colorB : LED_OFF));
+		a.deadline += a.periodNs / 2;
+		if (a.deadline <= now) {
+			a.deadline = now + a.periodNs / 2;	// Very late (e.g. suspended), start again from now
+		}
+	}
+	ScheduleLED(b_id);
+}
+
+// The animation thread: take the due LEDs from the wheel, then sleep until the next slot with a LED
+void x52p_ctrl::LEDThread() {
+	std::unique_lock<std::mutex> lock(ledAnimLock);
+	long long tick = x52p_now_ns() / LEDWheelTickNs;	// Last slot handled
+	while (!ledStop) {
+		long long now = x52p_now_ns();
+		long long nowTick = now / LEDWheelTickNs;
+		if (nowTick - tick > LEDWheelSlots) {
+			tick = nowTick - LEDWheelSlots;	// Every slot once is enough to catch up
+		}
+		for (;; ++tick) {	// Up to the current slot, which stays the last handled (some of it may not be due yet)
+			int* link = &ledWheel[tick % LEDWheelSlots];
+			while (*link != -1) {
+				int b_id = *link;
+				if (ledAnim[b_id].deadline <= now) {
+					*link = ledAnim[b_id].next;	// Due: out of the slot, AnimateLED() puts it in its next slot
+					ledAnim[b_id].scheduled = 0;
+					AnimateLED(b_id, now);
+				}
+				else {
+					link = &ledAnim[b_id].next;	// Later in this slot, or in a later round of the wheel
+				}
+			}
+			if (tick == nowTick) {
+				break;
+			}
+		}
+
+		// Earliest deadline in the first slot with a LED due in this round of the wheel
+		long long wake = -1;
+		bool any = false;
+		for (int i = 0; i < LEDWheelSlots && wake < 0; ++i) {
+			for (int b_id = ledWheel[(tick + i) % LEDWheelSlots]; b_id != -1; b_id = ledAnim[b_id].next) {
+				any = true;
+				if (ledAnim[b_id].deadline < (tick + i + 1) * LEDWheelTickNs && (wake < 0 || ledAnim[b_id].deadline < wake)) {
+					wake = ledAnim[b_id].deadline;
+				}
+			}
+		}
+		if (!any) {
+			ledWake.wait(lock);	// Nothing animated, wait for SetLEDPattern()
+			tick = x52p_now_ns() / LEDWheelTickNs;
+		}
+		else {
+			if (wake < 0) {
+				wake = (tick + LEDWheelSlots) * LEDWheelTickNs;	// Only later rounds, look again after this one
+			}
+			ledWake.wait_for(lock, std::chrono::nanoseconds(wake - x52p_now_ns()));
+		}
+	}
+}
+
+// Stop the animation thread, the LEDs keep their last color
+void x52p_ctrl::StopLEDThread() {
+	if (!ledThread.joinable()) {
+		return;
+	}
+	{
+		std::lock_guard<std::mutex> lock(ledAnimLock);
+		ledStop = true;
+	}
+	ledWake.notify_one();
+	ledThread.join();
+}
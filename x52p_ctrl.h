@@ -1,144 +1,815 @@
-// ---------------------------------------------------------------------------------------------------------- //
-// Osaka University: Dimas M. Rachman, 2022.
-// Header file, external dependency file.
-// Saitek/Logitech x52 pro HOTAS.
-
-// REQUIREMENTS
-// A.	Make sure you have installed DirectX SDK https://www.microsoft.com/en-us/download/details.aspx?id=6812.
-//		This SDK providess the necessary headers like dinput.h and libraries like dinput8.lib, dxguid.lib.
-
-// B.	Download the DirectOutput API (.lib, .h, and .dll) https://1drv.ms/u/s!Aq8Kg0iqxkdrgfxXZBc5CL-a9-SAaQ.
-//		See https://forums.frontier.co.uk/threads/how-to-use-x52-pro-sdk-making-us-of-the-mfd-and-leds.428813/.
-//		Put the DirectOutput.lib, DirectOutput.h, and DirectOutput.dll in your folder.
-
-// C.	Necessary files to be in your folder (where your .slx present, or the referenced path):
-//			1. DirectOutput.lib, DirectOutput.h, and DirectOutput.dll
-//			   (Put the DirectOuput.dll in the folder where your .exe presents)
-//			2. x52p_ctrl.h the header file: this file
-//			3. x52p_ctrl.cpp the function definition file
-// ---------------------------------------------------------------------------------------------------------- //
-
-
-#ifndef X52P_H
-#define X52P_H
-
-#define DIRECTINPUT_VERSION 0x0800	// DirectX version, MUST!
-#include <dinput.h>		// DirectInput API header
-#include <stdio.h>		// For std I/O namespace
-#include <iostream>		// For std I/0 stream
-#include <Windows.h>	// For ZeroMemory function
-#include <vector>		// For vector class
-extern "C" {
-#include "DirectOutput.h"	// For DirectOuput API header, pure C so use extern C
-}
-
-#pragma comment(lib, "dinput8.lib")	// The necessary libraries for DirectInput API
-#pragma comment(lib, "dxguid.lib")
-#pragma comment(lib, "DirectOutput.lib")	// For DirectOuput
-
-HINSTANCE hInstance = GetModuleHandle(NULL); // Instance of the window, null is fine
-
-// Define the struct for multiple joysticks
-// Note: the pointer to the interfaces is written as a struct for the ease in Simulink,
-//	     that is, to make it easier in general as a static variable in Simulink/CMEX S-Function API
-// A caveat is, every time a DirectInputDevice object is made, the DirectInput API is started.
-// See the InitDev() method.
-// See the Linux version where the SDL API is started only once. https://github.com/dimasmr/x52pHOTAS/tree/linux
-struct Joysticks
-{
-	unsigned int deviceCount;
-	IDirectInputDevice8** x52p_devs;	// Pointer to the interface of device, name it x52p_devs
-	IDirectInput8* x52p_inps;			// Pointer to the interface of input, name the pointer as x52p_inps
-};
-
-// Pointer to DirectOuput interface of the device
-// vector encapsulates dynamic size arrays https://en.cppreference.com/w/cpp/container/vector
-std::vector<void*> DOdevs;	// Pointer-to-pointer / pointers vector
-	
-// For MDF
-const wchar_t* text;	// Wide character pointer
-DWORD length;
-
-// Define the required values for normalization of the axes
-const double thrs = 32767.0f, thrsZ = 65535.0f;
-const int deadzone = 3500;	// Deadzone to prevent jumps due to light touch at the origins
-
-class x52p_ctrl {			
-public:						// Access specifier, public = can be accessed and modified outside the class
-	// Class constructors!
-	x52p_ctrl();			// Default constructor 
-	x52p_ctrl(int id);		// Constructor, accepts arguments, will be defined outside the class via Class::Class( args )
-	
-	// Class methods for DirectInput!
-	Joysticks InitDev();	// Methods (functions belong to a class, defined outside the class via void Class::Class( args ) { }
-	DIDEVCAPS GetCaps();
-	DIJOYSTATE2 GetState();	
-	int GetButtonNum();
-	void UnacqDev();
-
-	// Class methods for DirectOutput!
-	void DirectOutputInit();
-	void DirectOutputStop();
-	void SetMDFTextAuto(int autoflg, int VecTflg);
-	void SetMDFText(const wchar_t* text, DWORD length, DWORD pos);
-	void SetMDFLanding();
-	void SetLEDPressYellow(DWORD butt_id);
-	void SetLEDPressRed(DWORD butt_id);
-	void SetLEDPressGreen(DWORD butt_id);
-	void SetLEDOff(DWORD b_id);
-	void SetAllLEDGreen();
-	void SetAllLEDOff();
-
-	// Class methods for state normalization!
-	double XJoy();	// void has no return type, double returns a double type, bool returns binary 1 or 0 (T/F)
-	double YJoy();
-	double ZJoy();
-	double RXJoy();
-	double RYJoy();
-	double RZJoy();
-	double slid();
-	int povdeg();
-
-	// Class methods for buttons
-	int IsButtonPressed(int button_id);
-
-	// Class methods for debugging ID and device
-	int IsDevConnected();
-	int GetDevID();
-
-private:
-	// Class important variables! In private for safety! Comment out the above //private: for debugging!
-	DIDEVCAPS caps;			// DIDEVCAPS structure of DirectInput https://learn.microsoft.com/en-us/previous-versions/windows/desktop/ee416607(v=vs.85)
-	DIJOYSTATE2 state;		// DJOYSTATE structure of DirectInput https://learn.microsoft.com/en-us/previous-versions/windows/desktop/ee416627(v=vs.85)
-	Joysticks thejoys;
-	int joystick_id; 
-
-	DWORD dwPage = 1;
-	const wchar_t* name = L"X52P_App";			// Any name of the App, necessary
-	const wchar_t* pageDebugName = L"TestPage";	// Any page for debug, not necessary
-	// The L is a wchar_t literal, wide character, 16-bits storage
-};
-
-// DirectOuput LED IDs
-//DWORD LED_FIRE = 0;
-//DWORD LED_FIRE_A_RED = 1;
-//DWORD LED_FIRE_A_GREEN = 2;
-//DWORD LED_FIRE_B_RED = 3;
-//DWORD LED_FIRE_B_GREEN = 4;
-//DWORD LED_FIRE_D_RED = 5;
-//DWORD LED_FIRE_D_GREEN = 6;
-//DWORD LED_FIRE_E_RED = 7;
-//DWORD LED_FIRE_E_GREEN = 8;
-//DWORD LED_TOGGLE_1_2_RED = 9;
-//DWORD LED_TOGGLE_1_2_GREEN = 10;
-//DWORD LED_TOGGLE_3_4_RED = 11;
-//DWORD LED_TOGGLE_3_4_GREEN = 12;
-//DWORD LED_TOGGLE_5_6_RED = 13;
-//DWORD LED_TOGGLE_5_6_GREEN = 14;
-//DWORD LED_POV_2_RED = 15;
-//DWORD LED_POV_2_GREEN = 16;
-//DWORD LED_CLUTCH_RED = 17;
-//DWORD LED_CLUTCH_GREEN = 18;
-//DWORD LED_THROTTLE = 19;
-
+// ---------------------------------------------------------------------------------------------------------- //
+// Osaka University: Dimas M. Rachman, 2022.
+// Header file, external dependency file.
+// Saitek/Logitech x52 pro HOTAS.
+
+// REQUIREMENTS
+// A.	Make sure you have installed DirectX SDK https://www.microsoft.com/en-us/download/details.aspx?id=6812.
+//		This SDK providess the necessary headers like dinput.h and libraries like dinput8.lib, dxguid.lib.
+
+// B.	Download the DirectOutput API (.lib, .h, and .dll) https://1drv.ms/u/s!Aq8Kg0iqxkdrgfxXZBc5CL-a9-SAaQ.
+//		See https://forums.frontier.co.uk/threads/how-to-use-x52-pro-sdk-making-us-of-the-mfd-and-leds.428813/.
+//		Put the DirectOutput.lib, DirectOutput.h, and DirectOutput.dll in your folder.
+
+// C.	Necessary files to be in your folder (where your .slx present, or the referenced path):
+//			1. DirectOutput.lib, DirectOutput.h, and DirectOutput.dll
+//			   (Put the DirectOuput.dll in the folder where your .exe presents)
+//			2. x52p_ctrl.h the header file: this file
+//			3. x52p_ctrl.cpp the function definition file
+// ---------------------------------------------------------------------------------------------------------- //
+
+
+#ifndef X52P_H
+#define X52P_H
+
+#define DIRECTINPUT_VERSION 0x0800	// DirectX version, MUST!
+#include <dinput.h>		// DirectInput API header
+#include <stdio.h>		// For std I/O namespace
+#include <math.h>		// For the waveforms of the scenarios
+#include <iostream>		// For std I/0 stream
+#include <Windows.h>	// For ZeroMemory function
+#include <vector>		// For vector class
+#include <atomic>		// For the active MFD page, written by the DirectOutput callback thread
+#include <mutex>		// For the DirectOutput device registry
+#include <intrin.h>		// For _BitScanForward64, bit by bit over button masks, and __rdtsc
+#include <thread>		// For the LED animation thread
+#include <condition_variable>
+#include <emmintrin.h>	// SSE2, for the compact state conversions
+extern "C" {
+#include "DirectOutput.h"	// For DirectOuput API header, pure C so use extern C
+}
+
+#pragma comment(lib, "dinput8.lib")	// The necessary libraries for DirectInput API
+#pragma comment(lib, "dxguid.lib")
+#pragma comment(lib, "DirectOutput.lib")	// For DirectOuput
+
+// Define the struct for multiple joysticks
+// Note: the pointer to the interfaces is written as a struct for the ease in Simulink,
+//	     that is, to make it easier in general as a static variable in Simulink/CMEX S-Function API
+// A caveat is, every time a DirectInputDevice object is made, the DirectInput API is started.
+// See the InitDev() method. Objects made with OPEN_INPUT_SHARED start it once for all of them instead.
+// See the Linux version where the SDL API is started only once. https://github.com/dimasmr/x52pHOTAS/tree/linux
+struct Joysticks
+{
+	unsigned int deviceCount;
+	IDirectInputDevice8** x52p_devs;	// Pointer to the interface of device, name it x52p_devs
+	IDirectInput8* x52p_inps;			// Pointer to the interface of input, name the pointer as x52p_inps
+};
+
+// How a x52p_ctrl opens the devices, see x52p_ctrl(int id, int mode)
+// OPEN_FULL: its own DirectInput and enumeration, and DirectOutput (MFD and LEDs)
+// OPEN_INPUT_SHARED: DirectInput only, one DirectInput8 and one enumeration for all the objects opened this way
+// (e.g. the sources of x52p_fusion: rudder pedals and panels have no MFD, and N sources enumerate once)
+enum X52OpenMode { OPEN_FULL, OPEN_INPUT_SHARED };
+
+// Define the required values for normalization of the axes
+const double thrs = 32767.0f, thrsZ = 65535.0f;
+const int deadzone = 3500;	// Deadzone to prevent jumps due to light touch at the origins
+
+// Number of axes (X, Y, Z, RX, RY, RZ, slider) and buttons of the x52 pro
+const int AxisCount = 7, ButtonCount = 39;
+
+// Compact state of the x52 pro, 24 bytes instead of the 272 of DIJOYSTATE2, see COMPACT STATE in x52p_ctrl.cpp
+// The unit for copies of the state (snapshots, queues, logs), filled by GetState()
+struct X52State
+{
+	unsigned long long buttons;			// Bit i is button i (0 to 38)
+	unsigned short axes[AxisCount];		// Raw X, Y, Z, RX, RY, RZ, slider, 0 to 65535
+	unsigned char hat;					// POV aim in steps of 45 deg (0 up, clockwise), X52HatCentered if not used
+	unsigned char mode;					// Mode selector 1, 2, 3 (buttons 27 to 29), 0 if none reads
+};
+static_assert(sizeof(X52State) <= 32, "X52State must stay compact");
+
+const unsigned char X52HatCentered = 0xFF;
+const int X52ModeButton = 27;		// Button of mode 1, then 2 and 3
+const unsigned long long X52ButtonBits = (1ULL << ButtonCount) - 1;
+
+// Fields of X52StateDiff(): bits 0 to 6 the axes, then the hat, the mode, and one bit per button
+const int X52FieldHat = AxisCount, X52FieldMode = AxisCount + 1, X52FieldButton0 = AxisCount + 2;
+
+void X52StateFromDI(const DIJOYSTATE2* in, X52State* out);
+void X52StateToDI(const X52State* in, DIJOYSTATE2* out);
+unsigned long long X52StateDiff(const X52State* a, const X52State* b);
+double X52AxisValue(const X52State* s, int axis);
+void X52Normalize(const X52State* s, double axes[AxisCount]);
+int X52PovDeg(const X52State* s);
+
+// Configuration of the axes and the button LEDs, compiled from a text file into an immutable table
+// See CONFIGURATION in x52p_ctrl.cpp for the file, X52DefaultConfig() is the built-in one (the constants above).
+enum AxisMode { AXIS_CENTERED, AXIS_INVERTED, AXIS_THROTTLE, AXIS_LINEAR };
+
+struct X52AxisConfig
+{
+	int mode;			// AxisMode
+	double scale;		// Center (centered, inverted) or full range (throttle, linear), raw units
+	double deadzone;	// Raw units around the center, or from the idle end of the throttle
+};
+
+struct X52Config
+{
+	X52AxisConfig axes[AxisCount];
+	signed char ledOf[ButtonCount];		// LED (red ID, as SetLEDPress*) lit by each button, -1 none
+	unsigned char colorOf[ButtonCount];	// LEDColor of that LED
+	int failsafe[AxisCount];			// Raw value of each axis while the device is stalled, -1 holds the last good one
+};
+
+const X52Config* X52DefaultConfig();
+int X52ParseConfig(const char* text, X52Config* out, char* error, int errorSize);
+double X52ConfigAxis(const X52Config* cfg, const X52State* s, int axis);
+
+// Threads that read the configuration table of one x52p_ctrl, each passes its own epoch (see PassConfig())
+// Step: the thread of GetState() and of the axes methods, worker: a reading thread of x52p_fusion
+enum X52ConfigReader { CFG_READER_STEP, CFG_READER_WORKER, CFG_READERS };
+
+// Maximum number of x52p_ctrl objects using DirectOutput at the same time (e.g. HOTAS blocks in one model)
+const int DOMaxUsers = 8;
+const int DOMaxDevices = 8;	// Maximum number of x52 pros in the DirectOutput device registry
+
+// LEDs of the x52 pro (see the DirectOuput LED IDs at the end), the last value sent is kept per LED
+const int LEDCount = 20;
+const DWORD LEDUnknown = 0xFFFFFFFF;	// Not sent yet, the next value is always sent
+
+// LED animation, see SetLEDPattern(): patterns and colors (red and green together is yellow)
+enum LEDPattern { ANIM_NONE, ANIM_STEADY, ANIM_BLINK, ANIM_ALTERNATE, ANIM_FLASH };
+enum LEDColor { LED_OFF = 0, LED_RED = 1, LED_GREEN = 2, LED_YELLOW = 3 };
+const int LEDWheelSlots = 64;				// Timer wheel of the LED animation thread
+const long long LEDWheelTickNs = 5000000;	// 5 ms per slot
+
+// Animation of one LED (by the red LED ID, as SetLEDPress*), owned by the animation thread once set
+struct LEDAnim
+{
+	int pattern, colorA, colorB;
+	long long periodNs;		// Blink/alternate period, flash length
+	int prevPattern, prevA, prevB;	// Pattern shown again after a flash
+	long long prevPeriodNs;
+	int phase;				// 0 colorA, 1 the other color
+	long long deadline;		// Time (ns) of the next transition
+	int next;				// Next LED in the same timer wheel slot, -1 for none
+	int scheduled;
+};
+
+// MFD geometry: the x52 pro shows three lines of sixteen characters per page
+// MFDPages is how many pages one x52p_ctrl can keep in memory, see AddMFDPage()
+const int MFDPages = 4, MFDLines = 3, MFDChars = 16;
+
+// One preallocated line of the MFD, filled by the MFD FORMAT functions without heap or locale (no swprintf)
+// Text longer than the sixteen characters of the MFD is cut, see MFDPutText()
+struct MFDLine
+{
+	wchar_t text[MFDChars + 1];
+	DWORD length;
+};
+
+void MFDClear(MFDLine* line);
+void MFDPutText(MFDLine* line, const wchar_t* text);
+void MFDPutInt(MFDLine* line, long long value, int width);
+void MFDPutFixed(MFDLine* line, double value, int decimals, int width);
+void MFDFormatValue(MFDLine* line, const wchar_t* label, double value, int decimals, const wchar_t* unit);
+
+// Length of a wide string literal or array known at compile time, instead of wcslen at every call
+#define MFD_LEN(s) ((DWORD)(sizeof(s) / sizeof(wchar_t) - 1))
+
+// Output scheduler, see SetOutputBudget(): one slot per LED and per MFD line, only the newest value is sent
+// The slots are sent by priority: warning LEDs (see SetLEDPriority()), then the other LEDs, then the MFD
+enum OutPriority { OUT_PRIO_WARNING, OUT_PRIO_MODE, OUT_PRIO_MFD, OUT_PRIO_COUNT };
+const int OutSlotCount = LEDCount + MFDPages * MFDLines;	// 32, one bit each in the pending masks
+
+// Counters of the output scheduler, see GetOutputStats()
+struct OutputStats
+{
+	unsigned long long submitted;	// Writes asked (changed values only)
+	unsigned long long sent;		// DirectOutput calls made
+	unsigned long long deferred;	// Writes that waited for the budget
+	unsigned long long coalesced;	// Writes replaced by a newer value before being sent
+	int pending;					// Slots waiting now
+};
+
+class x52p_scenario;	// Scripted input instead of the device, see SetScenario()
+
+// One sample of the high-rate sampler, see StartSampler()
+struct X52Sample
+{
+	long long time;		// x52p_now_ns() of the read
+	X52State state;
+};
+const long long SamplerSpinNs = 200000;	// Last part of the wait between two samples spent spinning, see X52SleepUntil()
+
+// Spectrum of the stick over sliding windows, to see pilot-induced oscillations (PIO) while flying
+// Roll (X), pitch (Y), and yaw (RZ), centered -1 to 1 without deadzone. Goertzel filters on the DFT bins of the
+// band, Hann window, two windows overlapping by half: a result every window / 2 samples, for the same cost
+// per sample (2 x 3 x bins multiply-adds), nothing allocated after Configure(). See SPECTRUM in x52p_ctrl.cpp
+const int SpectrumAxes = 3;
+const int SpectrumMaxBins = 64;
+const int SpectrumAxisOf[SpectrumAxes] = { 0, 1, 5 };	// Of X52State::axes
+
+struct X52Spectrum
+{
+	double power[SpectrumAxes];	// Mean square in the band
+	double freq[SpectrumAxes];	// Dominant frequency in the band (Hz)
+	double amp[SpectrumAxes];	// Amplitude of it
+	long long windows;			// Windows done, 0 before the first
+	long long time;				// Time (ns) of the last sample of the last window
+};
+
+const int SpectrumWords = sizeof(X52Spectrum) / sizeof(long long);	// Copied as atomic words, see GetSpectrum()
+static_assert(sizeof(X52Spectrum) == SpectrumWords * sizeof(long long), "X52Spectrum must be whole 8 byte words");
+
+class x52p_spectrum;	// Goertzel filters of the analysis, see SetAnalysis()
+
+// Health of the device reads, see SetWatchdog()
+enum X52Health { HEALTH_OK, HEALTH_DEGRADED, HEALTH_STALLED };	// Degraded: last good state held, stalled: failsafe
+const long long WatchdogNever = -(1LL << 62);
+
+// Queue of soft button (MFD scroll wheel) presses, filled by the DirectOutput callback, see PopSoftButton()
+const unsigned int SoftButtonQueueSize = 64;	// Must be a power of two
+
+class x52p_ctrl {			
+public:						// Access specifier, public = can be accessed and modified outside the class
+	// Class constructors!
+	x52p_ctrl();			// Default constructor 
+	x52p_ctrl(int id);		// Constructor, accepts arguments, will be defined outside the class via Class::Class( args )
+	x52p_ctrl(int id, int mode);	// X52OpenMode, x52p_ctrl(id) is OPEN_FULL
+	~x52p_ctrl();			// Destructor, releases DirectInput and DirectOutput
+	
+	// Class methods for DirectInput!
+	Joysticks InitDev();	// Methods (functions belong to a class, defined outside the class via void Class::Class( args ) { }
+	DIDEVCAPS GetCaps();
+	const DIJOYSTATE2& GetState();	// Also fills the compact state, see GetCompactState()
+	const DIJOYSTATE2& ReadState(int reader);	// GetState() from the thread of another X52ConfigReader
+	const X52State& GetCompactState();
+	void SetPollDecimation(double minPeriod, int everyN);
+	int Poll();				// GetState() only when due, see SetPollDecimation()
+	double GetPollRate();
+	long long GetStateTime();	// Time (ns) of the state, for the predictor
+	void GetAxes(double axes[AxisCount]);	// X, Y, Z, RX, RY, RZ, slider with the configuration
+	void NormalizeAxes(const X52State* s, double axes[AxisCount]);	// The same for any state, e.g. a sample
+
+	// Class methods for the high-rate sampler: a thread reads the device at a fixed rate into a ring
+	int StartSampler(double rate, int capacity);
+	void StopSampler();
+	int ReadSamples(X52Sample* out, int max);	// Oldest first, returns how many
+	long long GetSamplerStart();
+	long long GetSamplerDrops();
+	void SetAnalysis(int window, double fLo, double fHi);	// Before StartSampler(), window 0 for none
+	int GetSpectrum(X52Spectrum* out);	// Last result of the analysis, 0 before the first window
+
+	// Class methods for the watchdog of the reads, checked in GetState()
+	void SetWatchdog(double stallBound, double freezeBound);
+	int GetHealth();		// X52Health
+	HRESULT GetLastResult();	// Of the last read of the device
+	int GetStallCount();
+
+	// Class methods for event-driven reads: sleep until the device signals new input instead of polling
+	int SetInputEvent(int on);	// 0 if the device cannot signal (polled device) or is shared, then poll as before
+	int WaitForInput(double timeout);	// Reads the state, 1 on new input, 0 at the timeout
+
+	// Class methods for the configuration file (axes and button LEDs), reloaded when it changes
+	int LoadConfig(const char* path);
+	int WatchConfig(const char* path);
+	void StopConfigWatch();
+	int GetConfigVersion();
+	void SetConfigReaders(int count);	// X52ConfigReader in use, 1 (the step) by default, see x52p_fusion
+	void PassConfig(int reader);	// The reader holds no table now, called by ReadState()
+	int GetConfigRejects();
+	void GetConfigError(char* text, int size);
+	void ShowButtonLEDs();
+	int GetButtonNum();
+	int GetDevCount();
+	void UnacqDev();
+	void ReleaseDev();
+
+	// Class methods for DirectOutput!
+	void DirectOutputInit();
+	void DirectOutputStop();
+	void SetMDFTextAuto(int autoflg, int VecTflg);
+	void SetMDFText(const wchar_t* text, DWORD length, DWORD pos);
+	int AddMFDPage(const wchar_t* debugName, int activate);
+	void SetMFDPageText(int page, DWORD pos, const wchar_t* text, DWORD length);
+	void SetMFDLine(int page, DWORD pos, const MFDLine* line);
+	int GetMFDActivePage();
+	void OnMFDPageChange(DWORD page, bool active);
+
+	// Class methods for the soft buttons (scroll wheel of the MFD)
+	int PopSoftButton(DWORD* pressed);
+	void GetSoftButtonCounts(int counts[3]);
+	void OnSoftButtonChange(DWORD buttons);
+	void OnDirectOutputDevice(void* hDevice, bool added);
+	void SetMDFLanding();
+	void SetLEDPressYellow(DWORD butt_id);
+	void SetLEDPressRed(DWORD butt_id);
+	void SetLEDPressGreen(DWORD butt_id);
+	void SetLEDOff(DWORD b_id);
+	void SetAllLEDGreen();
+	void SetAllLEDOff();
+	void ResetOutputs();
+	void SetLEDPattern(DWORD b_id, int pattern, int colorA, int colorB, double period);
+
+	// Class methods for the output scheduler (budget of DirectOutput calls)
+	void SetOutputBudget(double callsPerSecond, int burst);
+	void SetLEDPriority(DWORD b_id, int priority);
+	void PumpOutputs();
+	void GetOutputStats(OutputStats* stats);
+
+	// Class methods for state normalization!
+	double XJoy();	// void has no return type, double returns a double type, bool returns binary 1 or 0 (T/F)
+	double YJoy();
+	double ZJoy();
+	double RXJoy();
+	double RYJoy();
+	double RZJoy();
+	double slid();
+	int povdeg();
+
+	// Class methods for buttons
+	int IsButtonPressed(int button_id);
+	unsigned long long GetButtonMask();
+
+	// Class methods for a scripted input instead of the device (load tests, no HOTAS needed)
+	void SetScenario(x52p_scenario* source);
+	void SetSimTime(double t);
+
+	// Class methods for debugging ID and device
+	int IsDevConnected();
+	int GetDevID();
+
+private:
+	// Class important variables! In private for safety! Comment out the above //private: for debugging!
+	DIDEVCAPS caps;			// DIDEVCAPS structure of DirectInput https://learn.microsoft.com/en-us/previous-versions/windows/desktop/ee416607(v=vs.85)
+	DIJOYSTATE2 state;		// DJOYSTATE structure of DirectInput https://learn.microsoft.com/en-us/previous-versions/windows/desktop/ee416627(v=vs.85)
+	X52State cstate = { 0, { 0 }, X52HatCentered, 0 };	// Compact copy of state, the axes and buttons methods read this one
+	x52p_scenario* scenario = NULL;	// Not owned, GetState() samples it at simTime when set
+
+	// Watchdog, see WATCHDOG in x52p_ctrl.cpp, times as stateTime (no clock of its own)
+	void Watchdog(HRESULT hr, long long now);
+	long long wdStallNs = 20000000;		// Failing reads for longer: stalled
+	long long wdFreezeNs = 0;			// Same state for longer: stalled, 0 off
+	long long wdGoodTime = WatchdogNever, wdFreshTime = WatchdogNever;
+	X52State wdLastGood = { 0, { 32767, 32767, 65535, 0, 0, 32767, 0 }, X52HatCentered, 0 };	// Stick released
+	HRESULT wdResult = DI_OK;
+	int health = HEALTH_OK;
+	int stalls = 0;
+
+	// Event signaled by DirectInput when the device has new input, see INPUT EVENT in x52p_ctrl.cpp
+	HANDLE inEvent = NULL;
+
+	// Configuration, read by the steps without lock, replaced by the watcher thread (RCU: the old table is
+	// freed once every reader passed ReadState() after the swap), see CONFIGURATION in x52p_ctrl.cpp
+	int SwapConfig(const char* path);
+	void FreeRetiredConfigs(int all);
+	void ConfigWatchThread(int retry);
+	std::atomic<const X52Config*> cfg{ X52DefaultConfig() };
+	std::atomic<unsigned int> cfgEpoch{ 0 };	// Swaps so far
+	std::atomic<unsigned int> cfgSeen[CFG_READERS] = {};	// cfgEpoch at the last PassConfig() of each reader
+	int cfgReaders = 1;							// Readers in use, under cfgLock
+	const X52Config* cfgRetired[8];				// Replaced, freed when every cfgSeen reaches their epoch
+	unsigned int cfgRetiredEpoch[8];
+	int cfgRetiredCount = 0;
+	std::atomic<int> cfgRejects{ 0 };
+	char cfgError[160] = "";
+	std::mutex cfgLock;				// Loads and the error text, never taken by the steps
+	std::thread cfgThread;
+	HANDLE cfgStopEvent = NULL;		// Wakes the watcher thread to stop
+	char cfgPath[260] = "";
+	long long stateTime = 0;		// x52p_now_ns() of the last GetState(), or simTime with a scenario
+
+	// Poll decimation, see Poll()
+	long long pollPeriodNs = 0;		// Wall-clock time between two polls at least
+	int pollEvery = 1;				// Poll every N calls of Poll() at most
+	int pollSkip = 0;				// Calls since the last poll
+	long long pollLast = -(1LL << 62);	// Time of the last poll, long ago at first
+	long long pollWindow = 0;		// Start of the window of the poll rate
+	int pollCount = 0;				// Polls in the window
+	double pollRate = 0;			// Polls per second in the last window
+	double simTime = 0;
+	Joysticks thejoys = { 0 };	// Empty until InitDev(), released by ReleaseDev()
+	int diShared = 0;			// OPEN_INPUT_SHARED: thejoys is a copy of the shared one, see InitDev()
+	int joystick_id; 
+	GUID diInstance;	// DirectInput instance GUID of the device, used to find the same device in DirectOutput
+
+	// Pointer to DirectOutput interface of the device, owned by this object, NULL if the device has no MFD/LEDs
+	// Matched by DirectOutput_GetDeviceInstance == diInstance, see OnDirectOutputDevice()
+	// Written under outLock (and DOlock) by the device callback thread, read by the solver and the scheduler
+	std::atomic<void*> DOdev{ NULL };
+	wchar_t DOserial[64];	// Serial number of the DirectOutput device, for debugging
+	void DetachDirectOutput();
+	DWORD dwPage = 1;
+	const wchar_t* name = L"X52P_App";			// Any name of the App, necessary
+	const wchar_t* pageDebugName = L"TestPage";	// Any page for debug, not necessary
+	// The L is a wchar_t literal, wide character, 16-bits storage
+
+	// MFD pages kept in memory, page index p is the DirectOutput page dwPage + p
+	// Only the active page is pushed to the device, see SetMFDPageText() and OnMFDPageChange()
+	wchar_t mfdText[MFDPages][MFDLines][MFDChars + 1];
+	DWORD mfdLength[MFDPages][MFDLines];
+	int mfdPageCount = 0;
+	std::atomic<int> mfdActive{ -1 };	// Index of the page shown on the MFD, -1 if none of ours
+	void FlushMFDPage(int page);
+	void SetLed(DWORD id, DWORD value);
+	DWORD ledState[LEDCount];	// Last value sent per LED, LEDUnknown before the first
+
+	// LED animation: one thread, timer wheel of the transitions, see LED ANIMATION in x52p_ctrl.cpp
+	void SendLed(DWORD id, DWORD value);
+	void ShowLEDColor(int b_id, int color);
+	void ScheduleLED(int b_id);
+	void UnscheduleLED(int b_id);
+	void AnimateLED(int b_id, long long now);
+	void LEDThread();
+	void StopLEDThread();
+	LEDAnim ledAnim[LEDCount];
+	int ledWheel[LEDWheelSlots];			// First LED of each slot, -1 if empty
+	std::atomic<unsigned int> ledAnimMask{ 0 };	// Bit i: LED i belongs to the animation thread
+	std::thread ledThread;
+	std::mutex ledAnimLock;
+	std::condition_variable ledWake;
+	bool ledStop = false;
+
+	// Output scheduler: token bucket, pending slots by priority, see OUTPUT SCHEDULER in x52p_ctrl.cpp
+	void SubmitOutput(int slot);
+	int ReadyOutput(int slot);
+	void PumpLocked(long long now);
+	void FlushOutputs(std::unique_lock<std::mutex>& lock);
+	std::mutex outLock;				// Solver, LED animation and DirectOutput callback threads all write
+	DWORD outLed[LEDCount];			// Newest value of each LED slot (the MFD slots use mfdText)
+	int outPrio[OutSlotCount];
+	unsigned int outPending[OUT_PRIO_COUNT];	// Bit per slot
+	unsigned int outReady = 0;		// Bit per slot: past the budget, FlushOutputs() sends it
+	bool outSending = false;		// A thread is in FlushOutputs(), it sends the slots made ready meanwhile
+	double outRate = 0;				// Calls per second, 0 for no budget
+	double outBurst = 1, outTokens = 1;
+	long long outRefill = 0;		// Time (ns) of the last refill
+	OutputStats outStats;
+
+	// Sampler, single producer (sampler thread) single consumer (the caller) ring, lock-free
+	void SamplerThread();
+	X52Sample* smpRing = NULL;		// smpSize samples, a power of two, allocated by StartSampler()
+	unsigned int smpSize = 0;
+	alignas(64) std::atomic<unsigned int> smpHead{ 0 };	// Written by the sampler thread
+	alignas(64) std::atomic<unsigned int> smpTail{ 0 };	// Written by the caller
+	std::atomic<long long> smpDrops{ 0 };	// Samples lost, ring full
+	long long smpPeriodNs = 0, smpStart = 0;
+	std::thread smpThread;
+	std::atomic<bool> smpStop{ false };
+
+	// Analysis of the samples on a thread of its own, fed by the sampler through a second ring
+	void AnalysisThread();
+	int anWindow = 0;
+	double anLow = 0, anHigh = 0;
+	x52p_spectrum* anSpectrum = NULL;	// With the rings, allocated by StartSampler()
+	X52Sample* anRing = NULL;
+	unsigned int anSize = 0;
+	alignas(64) std::atomic<unsigned int> anHead{ 0 };
+	alignas(64) std::atomic<unsigned int> anTail{ 0 };
+	std::atomic<unsigned int> anSeq{ 0 };	// Odd while anResult is written
+	std::atomic<long long> anResult[SpectrumWords];	// X52Spectrum word by word, read while written
+	std::thread anThread;
+
+	// Soft button presses, single producer (DirectOutput thread) single consumer (the caller) ring, lock-free
+	DWORD sbQueue[SoftButtonQueueSize];
+	std::atomic<unsigned int> sbHead{ 0 }, sbTail{ 0 };
+	DWORD sbLast = 0;	// Soft buttons held at the last callback, used by the callback only
+};
+
+// Mapping of the physical inputs to a vector of logical outputs (shift layers, toggles, trims, hat as axes)
+// The rules are compiled once into a flat array of instructions, evaluated every step without allocation.
+// Example, pinkie (button 5) as shift: { MAP_AXIS, 0, -1, MAP_NO_LAYER, 0, 1.0 } X to output 0,
+//	{ MAP_AXIS, 0, -1, 5, 1, 1.0 } X to output 1 while pinkie held, { MAP_HAT_X, 0, -1, MAP_ANY_LAYER, 2, 1.0 } hat
+enum MapType { MAP_AXIS, MAP_BUTTON, MAP_TOGGLE, MAP_AXIS_FROM_BUTTONS, MAP_HAT_X, MAP_HAT_Y };
+const int MAP_NO_LAYER = -1;	// Rule of the base layer, only when no shift button is held
+const int MAP_ANY_LAYER = -2;	// Rule always active
+const int MapMaxRules = 512, MapMaxOutputs = 128;
+
+struct MapRule
+{
+	int type;		// MapType
+	int src;		// Axis (0 X, 1 Y, 2 Z, 3 RX, 4 RY, 5 RZ, 6 slider) or button (0 to 38), unused for the hat
+	int src2;		// MAP_AXIS_FROM_BUTTONS: button that decreases (src increases), -1 for none
+	int layer;		// Shift button that must be held, MAP_NO_LAYER or MAP_ANY_LAYER
+	int out;		// Index in the logical output vector
+	double gain;	// Scale of the axis/hat, value of the button/toggle, rate per second of the axis from buttons
+};
+
+struct MapInstr
+{
+	unsigned long long condMask, condValue;	// Active when (buttons & condMask) == condValue
+	double gain;
+	unsigned short out;
+	unsigned char op, src, src2, hasSrc2;
+};
+
+class x52p_map {
+public:
+	int Compile(const MapRule* rules, int count);
+	int GetOutputNum();
+	void Reset();
+	void Eval(x52p_ctrl* c, double dt, double* out);
+
+private:
+	MapInstr code[MapMaxRules];		// The compiled rules
+	double memory[MapMaxRules];		// Value of the toggles and axes from buttons, per instruction
+	int codeCount = 0, outCount = 0;
+	unsigned long long prevButtons = 0;
+};
+
+// Gestures on the buttons: press, release, long press, double tap, and chords (a set of buttons pressed together)
+// Update() looks only at the buttons that changed (bit masks), plus the held ones once their long press is due.
+enum GestureType { GESTURE_PRESS, GESTURE_RELEASE, GESTURE_LONG, GESTURE_DOUBLE, GESTURE_CHORD };
+const int GestureMaxChords = 16, GestureMaxEvents = 64;
+
+struct GestureEvent
+{
+	unsigned char type;	// GestureType
+	unsigned char id;	// Button (0 to 38), or chord index for GESTURE_CHORD
+};
+
+class x52p_gesture {
+public:
+	x52p_gesture();
+	void SetWindows(double longPress, double doubleTap, double chord);
+	int AddChord(unsigned long long buttons);
+	int Update(unsigned long long buttons, long long now);
+	const GestureEvent* GetEvents();
+
+private:
+	void Emit(int type, int id);
+
+	long long longNs = 500000000LL;		// Held this long (ns) is a long press
+	long long doubleNs = 300000000LL;	// Second press within this time (ns) after a short tap is a double tap
+	long long chordNs = 100000000LL;	// All buttons of a chord pressed within this time (ns)
+	long long pressTime[ButtonCount], releaseTime[ButtonCount];
+	unsigned long long prev = 0;		// Buttons at the last Update()
+	unsigned long long waitLong = 0;	// Held, long press not reported yet
+	unsigned long long shortTap = 0;	// Last press was short, a double tap is possible
+	long long nextLong = 0;				// Earliest long press due among waitLong
+	unsigned long long chords[GestureMaxChords];
+	int chordCount = 0;
+	GestureEvent events[GestureMaxEvents];
+	int eventCount = 0;
+};
+
+// Prediction of the normalized axes a short time ahead (lead), to make up for the input latency
+// Alpha-beta filter per axis (steady-state Kalman filter of constant velocity), constant time, no allocation.
+// Update() at each new sample with its time, Predict() extrapolates the last sample by the lead time.
+// The prediction stays in the range of each axis, and an axis in its deadzone (exactly 0) predicts 0.
+class x52p_predict {
+public:
+	void SetGains(double alpha, double beta);
+	void Reset();
+	void Update(const double axes[AxisCount], long long time);
+	void Predict(double lead, double out[AxisCount]);
+
+private:
+	double alpha = 0.5, beta = 0.1;	// Gains on the position and velocity residuals, 0 to 1
+	double pos[AxisCount], vel[AxisCount];
+	long long last = 0;				// Time (ns) of the last sample
+	int valid = 0;					// pos/vel hold a sample
+};
+
+// Change gate: tells when the state changed enough to matter, to run downstream logic only then
+// Buttons, hat, and mode are compared exactly. An axis must move by enter (raw units, 0 to 65535) from the
+// value last reported to count, then by exit only while it keeps moving (hysteresis: the noise of an axis at
+// rest does not fire, an axis being moved reports its smaller steps too).
+class x52p_gate {
+public:
+	void SetThresholds(unsigned short enter, unsigned short exit);
+	void SetAxisThresholds(int axis, unsigned short enter, unsigned short exit);
+	void Reset();
+	unsigned long long Update(const X52State* s);	// Fields changed (as X52StateDiff()), 0 if nothing
+
+private:
+	X52State ref;		// State last reported, per field
+	int valid = 0;
+	unsigned short enter[AxisCount] = { 512, 512, 512, 512, 512, 512, 512 };	// 0.8 % of the range
+	unsigned short exit[AxisCount] = { 128, 128, 128, 128, 128, 128, 128 };
+	unsigned int moving = 0;	// Bit per axis that changed at the last Update()
+};
+
+// Subscriptions: callbacks with an interest mask over the fields of X52StateDiff() (axes, hat, mode, buttons)
+// Dispatch() takes one diff per poll and calls only the subscribers with a changed field in their mask, once
+// each, with the changed fields of their mask. One list of subscribers per field: the cost follows the changed
+// fields and who listens to them, not the number of subscribers. Fixed tables, nothing allocated.
+//	x52p_subs subs; subs.Subscribe(1ULL << 2, OnThrottle, &engine);	// Z only
+//	if (c.Poll()) subs.Dispatch(&c.GetCompactState());
+typedef void (*X52Callback)(void* user, const X52State* s, unsigned long long fields);
+const int SubsMax = 512;
+const int SubsFields = X52FieldButton0 + ButtonCount;	// 48
+
+class x52p_subs {
+public:
+	int Subscribe(unsigned long long mask, X52Callback fn, void* user);	// Returns the id, -1 if full
+	void Unsubscribe(int id);
+	void Reset();		// Forget the state, the next Dispatch() reports every field
+	int Dispatch(const X52State* s);	// Returns the number of callbacks made
+	int DispatchFields(const X52State* s, unsigned long long fields);	// Fields already known, e.g. x52p_gate
+	int GetCount();
+
+private:
+	X52Callback fn[SubsMax];
+	void* user[SubsMax];
+	unsigned long long mask[SubsMax];	// 0 for a free id
+	unsigned int stamp[SubsMax];		// Dispatch that last took it, called once per dispatch
+	unsigned short members[SubsFields][SubsMax];	// Ids listening to each field
+	unsigned short memberCount[SubsFields] = { 0 };
+	unsigned short due[SubsMax];
+	int used = 0;			// Ids 0 to used - 1 were given
+	int count = 0;
+	unsigned int generation = 0;
+	X52State last;
+	int valid = 0;
+};
+
+// Fusion of several devices (HOTAS, rudder pedals, panels) into one vector, read together in each step
+// Each source is an x52p_ctrl (its own joystick ID, configuration, or scenario). Step() reads them all, in
+// parallel with one thread each (threaded), and waits for them skewBound at most: a source not read in time
+// gives its last state read, and GetSkew() tells how far behind the newest source each one is. See FUSION in x52p_ctrl.cpp
+enum FusionKind { FUSE_AXIS, FUSE_BUTTON, FUSE_HAT };
+const int FusionMaxSources = 8, FusionMaxChannels = 256;
+
+struct FusionChannel
+{
+	int source;		// Index given by AddSource()
+	int kind;		// FusionKind
+	int index;		// Axis (0 X to 6 slider, with the configuration of the source) or button, unused for the hat
+	double gain;	// Scale of the axis or value of the button, the hat is in degrees (-1000 centered, as povdeg())
+};
+
+class x52p_fusion {
+public:
+	~x52p_fusion();		// Stops the threads, the sources are not deleted
+	int AddSource(x52p_ctrl* c);	// Not owned, before Start(), returns the index, -1 if full
+	int SetLayout(const FusionChannel* channels, int count);	// 0 if a channel is wrong
+	int Start(int threaded, double skewBound);
+	void Stop();
+	void SetSimTime(double t);	// For sources with a scenario, see SetScenario()
+	int Step(double* out);		// Reads the sources, fills GetChannelNum() values, returns how many were read in time
+	double GetSkew(int source);	// Seconds behind the newest source at the last Step()
+	int GetChannelNum();
+	int GetSourceNum();
+
+private:
+	void Worker(int i);
+	void Read(int i, int reader, X52State* s, long long* time);
+
+	x52p_ctrl* src[FusionMaxSources];
+	int srcCount = 0;
+	FusionChannel layout[FusionMaxChannels];
+	int chCount = 0;
+	X52State held[FusionMaxSources];		// Last state read in time, used by the channels
+	long long heldTime[FusionMaxSources];
+	X52State result[FusionMaxSources];		// Last read of each thread, under lock
+	long long resultTime[FusionMaxSources];
+	unsigned int done[FusionMaxSources];	// Generation of result, under lock
+	unsigned int taken[FusionMaxSources];	// Generation of held
+	double skew[FusionMaxSources];
+	std::thread workers[FusionMaxSources];
+	std::mutex lock;
+	std::condition_variable wake, doneWake;
+	unsigned int generation = 0;	// Steps so far, a new one starts the reads
+	int remaining = 0;				// Reads of this generation not done yet
+	double simTime = 0;
+	bool stop = false;
+	int threads = 0;
+	long long boundNs = 2000000;
+};
+
+// Spectrum of the stick over sliding windows, see X52Spectrum
+class x52p_spectrum {
+public:
+	~x52p_spectrum();
+	int Configure(double rate, int window, double fLo, double fHi);	// 0 if no bin in the band
+	int Push(const double x[SpectrumAxes], long long time);	// 1 when a window ended, see GetResult()
+	const X52Spectrum& GetResult();
+	int GetBinCount();
+
+private:
+	void Finish(int bank, long long time);
+
+	double* hann = NULL;		// window values, allocated by Configure()
+	int window = 0;
+	double rate = 0, sumW = 0, sumW2 = 0;
+	int bins = 0;
+	int firstBin = 0;			// DFT bin of the 1st Goertzel filter
+	double coef[SpectrumMaxBins];	// 2 cos(2 pi k / window)
+	double s1[2][SpectrumAxes][SpectrumMaxBins], s2[2][SpectrumAxes][SpectrumMaxBins];	// Per bank (window)
+	int pos[2];					// Sample of each bank in its window, negative before its first window
+	X52Spectrum result;
+};
+
+// Scenario: synthetic input from a small script, sampled at any time without keeping samples (hours cost nothing)
+// One segment per line: start end target waveform parameters, times in seconds, '#' starts a comment
+//	targets: x y z rx ry rz slider (raw 0 to 65535), hat (0 to 7, -1 centered), mode (1 to 3), button N (0 to 38)
+//	axes:	 const v | ramp a b | step a b delay | sine center amp freq | sweep center amp f0 f1 | noise center amp [rate]
+//	buttons: hold | pulse period duty | storm rate (random presses, new draw rate times per second)
+//	hat:	 dir d | rotate rate (steps of 45 deg per second)
+//	device:	 freeze (the reads give the same state) | error (the reads fail), to try the watchdog, see SetWatchdog()
+//	"seed N" sets the noise and storms, the same seed gives the same input. Example:
+//		seed 7
+//		0 10 x sweep 32767 30000 0.1 5		# X sine sweep 0.1 to 5 Hz over ten seconds
+//		0 60 slider noise 20000 800
+//		5 6 button 0 pulse 0.1 0.5			# Trigger at 10 Hz during one second
+// Where no segment is active the stick rests (X, Y, RZ centered, throttle Z idle, hat centered).
+// When segments of a target overlap the one that starts last wins.
+enum ScenarioWave { WAVE_CONST, WAVE_RAMP, WAVE_STEP, WAVE_SINE, WAVE_SWEEP, WAVE_NOISE,
+	WAVE_HOLD, WAVE_PULSE, WAVE_STORM, WAVE_DIR, WAVE_ROTATE, WAVE_FREEZE, WAVE_ERROR };
+const int ScenarioMaxSegments = 1024;
+const int ScenarioDevice = X52FieldButton0 + ButtonCount;	// Targets numbered as the fields of X52StateDiff()
+const int ScenarioTargets = ScenarioDevice + 1;
+
+struct ScenarioSegment
+{
+	double start, end;
+	int target;		// 0 to 6 axes, X52FieldHat, X52FieldMode, X52FieldButton0 + button, ScenarioDevice
+	int wave;		// ScenarioWave
+	double p[4];	// Parameters of the waveform
+};
+
+class x52p_scenario {
+public:
+	int Load(const char* script);
+	int LoadFile(const char* path);
+	const char* GetError();
+	double GetDuration();
+	void Sample(double t, X52State* out);
+	void SampleDI(double t, DIJOYSTATE2* out);
+	int GetFault();		// Device fault at the last Sample(): 0, WAVE_FREEZE or WAVE_ERROR
+
+private:
+	double Value(const ScenarioSegment& seg, double t);
+	double Noise(int target, long long k);
+
+	ScenarioSegment segs[ScenarioMaxSegments];	// Sorted by target, then start
+	int segCount = 0;
+	int first[ScenarioTargets + 1];		// Segments of target i are first[i] to first[i + 1] - 1
+	int cursor[ScenarioTargets];		// Last segment found per target, samples are mostly in order
+	unsigned long long used = 0;		// Bit per target with segments
+	unsigned long long seed = 0;
+	int fault = 0;
+	double duration = 0;
+	char error[128] = "";
+};
+
+// Monotonic time in nanoseconds, see TIME in x52p_ctrl.cpp
+long long x52p_now_ns();
+HANDLE X52CreateTimer();
+void X52SleepUntil(long long deadline, HANDLE timer, long long spinNs);
+
+// Trace of where the time goes in a step, compiled in with X52P_TRACE only (mex -DX52P_TRACE ...)
+// X52P_TRACE_SCOPE("name") records from there to the end of the block, the name must be a string literal.
+// X52P_TRACE_EXPORT("file.json") writes the Chrome trace JSON (open in Perfetto), see TRACE in x52p_ctrl.cpp
+#ifdef X52P_TRACE
+struct X52TraceEvent
+{
+	const char* name;
+	long long begin, end;	// Time stamp counter (__rdtsc), converted to ns at the export
+	int tid;				// Thread, numbered from 1 in the order of the first event
+};
+
+class X52TraceScope {
+public:
+	explicit X52TraceScope(const char* name) : name(name), begin((long long)__rdtsc()) {}
+	~X52TraceScope();
+private:
+	const char* name;
+	long long begin;
+};
+
+int X52TraceExport(const char* path);
+void X52TraceClear();
+
+#define X52P_TRACE_CAT2(a, b) a##b
+#define X52P_TRACE_CAT(a, b) X52P_TRACE_CAT2(a, b)
+#define X52P_TRACE_SCOPE(name) X52TraceScope X52P_TRACE_CAT(x52TraceScope, __LINE__)(name)
+#define X52P_TRACE_EXPORT(path) (X52TraceExport(path), X52TraceClear())
+#else
+#define X52P_TRACE_SCOPE(name)
+#define X52P_TRACE_EXPORT(path)
+#endif
+
+// Keep x52p_ctrl objects between runs (warm start), see WARM START in x52p_ctrl.cpp
+x52p_ctrl* WarmStartTake(int id);
+int WarmStartKeep(x52p_ctrl* c);
+void WarmStartRelease(int id);
+int WarmStartCount();
+
+// DirectOuput LED IDs
+//DWORD LED_FIRE = 0;
+//DWORD LED_FIRE_A_RED = 1;
+//DWORD LED_FIRE_A_GREEN = 2;
+//DWORD LED_FIRE_B_RED = 3;
+//DWORD LED_FIRE_B_GREEN = 4;
+//DWORD LED_FIRE_D_RED = 5;
+//DWORD LED_FIRE_D_GREEN = 6;
+//DWORD LED_FIRE_E_RED = 7;
+//DWORD LED_FIRE_E_GREEN = 8;
+//DWORD LED_TOGGLE_1_2_RED = 9;
+//DWORD LED_TOGGLE_1_2_GREEN = 10;
+//DWORD LED_TOGGLE_3_4_RED = 11;
+//DWORD LED_TOGGLE_3_4_GREEN = 12;
+//DWORD LED_TOGGLE_5_6_RED = 13;
+//DWORD LED_TOGGLE_5_6_GREEN = 14;
+//DWORD LED_POV_2_RED = 15;
+//DWORD LED_POV_2_GREEN = 16;
+//DWORD LED_CLUTCH_RED = 17;
+//DWORD LED_CLUTCH_GREEN = 18;
+//DWORD LED_THROTTLE = 19;
+
 #endif
\ No newline at end of file
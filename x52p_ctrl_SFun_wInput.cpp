@@ -1,226 +1,607 @@
-// ---------------------------------------------------------------------------------------------------------- //
-// Osaka University: Dimas M. Rachman, 2022.
-// C MEX S-Function for Simulink with two inputs and LED/MDF modification.
-// Saitek/Logitech x52 pro HOTAS.
-
-// REQUIREMENTS
-// A.	Make sure you have installed DirectX SDK https://www.microsoft.com/en-us/download/details.aspx?id=6812.
-//		This SDK providess the necessary headers like dinput.h and libraries like dinput8.lib, dxguid.lib.
-
-// B.	Download the DirectOutput API (.lib, .h, and .dll) https://1drv.ms/u/s!Aq8Kg0iqxkdrgfxXZBc5CL-a9-SAaQ.
-//		See https://forums.frontier.co.uk/threads/how-to-use-x52-pro-sdk-making-us-of-the-mfd-and-leds.428813/.
-//		Put the DirectOutput.lib, DirectOutput.h, and DirectOutput.dll in your folder.
-
-// C.	Necessary files to be in your folder (where your .slx present, or the referenced path):
-//			1. DirectOutput.lib, DirectOutput.h, and DirectOutput.dll
-//			2. x52p_ctrl.h the header file
-//			3. x52p_ctrl.cpp the function definition file
-//			4. This file
-
-// HOW TO COMPILE (FOR MATLAB SIMULINK)
-// You need C++ compiler available in your system.
-// Be sure to set the compiler appropriately for C++, use "mex -setup" and choose accordingly.
-// Compile in Matlab with "mex x52p_ctrl_SFun_wInput.cpp".
-// This gives you a mexw64 file (Matlab executable file) in the folder, which is why the DirectOutput.dll
-//		should be in the same place with the executable file.
-// ---------------------------------------------------------------------------------------------------------- //
-
-
-#define S_FUNCTION_NAME  x52p_ctrl_SFun_wInput		// define S-Function Name
-#define S_FUNCTION_LEVEL 2							// define S-Function Level
-
-#include "simstruc.h"		// For Simulink S-Function
-#include "x52p_ctrl.cpp"	// Functions definitions
-
-// Check parameters, hmm still needs checking
-#define MDL_CHECK_PARAMETERS
-#if defined (MDL_CHECK_PARAMETERS) && defined(MATLAB_MEX_FILE)
-
-static void mdlCheckParameters(SimStruct* S) {
-	size_t NrParameters = mxGetNumberOfElements(ssGetSFcnParam(S, 0)); // Take number of element in the SFun param
-	real_T* joyid_param = (real_T*)mxGetPr(ssGetSFcnParam(S, 0)); // Take pointer of the SFun param, must be double, name it joystick_id
-
-	const char* msg = NULL; // allocate pointer for message of char with null/zeros
-
-	if (NrParameters != 1) { // If people enters array, check!
-		msg = "Put only one joystick ID, not an array.";
-	}
-	else { // If people joystick ID not 0, put error!
-		if (joyid_param[0] != 0) {
-			msg = "PLEASE USE ID 0, SORRY! WILL FIX THIS WHEN IT IS POSSIBLE";
-		}
-	}
-	if (msg != NULL) { // Give error if and break Simulink if either message is coming
-		ssSetErrorStatus(S, msg);
-		return;
-	}
-}
-#endif 
-
-// Initialize the S-Function block parameter
-static void mdlInitializeSizes(SimStruct* S) {
-	ssSetNumSFcnParams(S, 1);	// Expect a parameter: joystick ID, default is 0 !!!
-	if (ssGetNumSFcnParams(S) == ssGetSFcnParamsCount(S)) {
-		mdlCheckParameters(S);	// Run the check, if msg is coming, then break Simulink
-		if (ssGetErrorStatus(S) != NULL) {
-			return;
-		}
-	}
-	else { // If the number of parameters does not match, break Simulink
-		return;
-	}
-
-	ssSetNumContStates(S, 0);	// No continuous states
-	ssSetNumDiscStates(S, 0);	// No discrete states
-
-	if (!ssSetNumInputPorts(S, 2)) { // One input ports (Auto and VecTwin)
-		return; // Break Simulink if there are input ports
-	}
-
-	ssSetInputPortWidth(S, 0, 1); // 1st port: Auto 
-	ssSetInputPortWidth(S, 1, 1); // 2nd port: VecTwin
-	ssSetInputPortDirectFeedThrough(S, 0, 1);	// To make sure that the input is available!
-	ssSetInputPortDirectFeedThrough(S, 1, 1);	// To make sure that the input is available!
-
-	if (!ssSetNumOutputPorts(S, 4)) { // Four outputs: axes, slider, pov, button, flags
-		return; // Break Simulink if the number of output ports is not correct
-	}
-
-	ssSetOutputPortWidth(S, 0, 6);	// 1st port: Six axes X, Y, Z, and RX, RY, RZ
-	ssSetOutputPortWidth(S, 1, 1);	// 2nd port: One slider
-	ssSetOutputPortWidth(S, 2, 1);	// 3rd port: One PovAim
-	ssSetOutputPortWidth(S, 3, 39);	// 4th port: Thirty nine buttons
-
-	ssSetNumSampleTimes(S, -1);	// If sample time is inherited, use -1
-	ssSetNumPWork(S, 1);		// Set pointers for persistent objects!
-	ssSetNumModes(S, 0);
-	ssSetNumNonsampledZCs(S, 0);
-
-	ssSetOperatingPointCompliance(S, USE_DEFAULT_OPERATING_POINT); // Misc for save/restore the Simulink
-}
-
-// Initialize the S-Function block parameter: sample time
-static void mdlInitializeSampleTimes(SimStruct* S) {
-	ssSetSampleTime(S, 0, INHERITED_SAMPLE_TIME);	// Set to inherit the simulink
-	ssSetOffsetTime(S, 0, 0.0);	// No offset
-}
-
-// Callback to initialize initial state just once! Make persist the DirectInput object
-#define MDL_START 
-#if defined(MDL_START) 
-static void mdlStart(SimStruct* S) {
-	// Get the S-Function parameter, here is the joystick ID
-	real_T* joyid_param = (real_T*)mxGetPr(ssGetSFcnParam(S, 0));
-	// int joyid_chk = int(joyid_param[0]); // For debugging
-	// std::cout << joyid_chk;
-
-	// Check and give error to make sure
-	if (joyid_param[0] != 0) {
-		ssSetErrorStatus(S, "PLEASE USE ID 0, SORRY! WILL FIX THIS WHEN IT IS POSSIBLE");
-	}
-
-	// Use PWork (pointer that points to a vector of pointers)
-	// to make DirectInput object persist (and DirectOutput)
-	// Create the object x52p_ctrl with joystick_id, default is 0!!
-	void** PWork = ssGetPWork(S);
-	PWork[0] = (void*) new x52p_ctrl(int(joyid_param[0]));	// allocate memory with new
-}
-#endif
-
-// Update the output: the state of the Joystick
-static void mdlOutputs(SimStruct* S, int_T tid) {
-	// Get the output of SFun to be used in Simulink, everything is double
-	// Convert to the appropriate data type to a pointer
-	real_T* axes = (real_T*)ssGetOutputPortRealSignal(S, 0);
-	real_T* slider = (real_T*)ssGetOutputPortRealSignal(S, 1);
-	real_T* povaim = (real_T*)ssGetOutputPortRealSignal(S, 2);
-	real_T* buttons = (real_T*)ssGetOutputPortRealSignal(S, 3);
-
-	// Get the input of SFun to be used here, all double
-	InputRealPtrsType auto_ptr = ssGetInputPortRealSignalPtrs(S, 0);
-	InputRealPtrsType VT_ptr = ssGetInputPortRealSignalPtrs(S, 1);
-
-	// Take the pointer to the persistent DirectInput object from the pointer vectors, name it c.
-	x52p_ctrl* c = (x52p_ctrl*)ssGetPWork(S)[0];
-
-	// Update the state by calling the method in the object
-	c->GetState();
-
-	// DEBUGGING, MAKE PUBLIC ALL CLASS VARIABLES
-	//std::cout << c->thejoys.x52p_devs;	// Print out the DirecInput object, should persist each time step
-	//std::cout << c->joystick_id;			// For debuggin please always make public the class variables in the x52p_ctrl.h
-	//std::cout << &c->state.lX << &c->state;
-	//bool rsp = c->IsDevConnected();
-	//int chkID = c->GetDevID();
-	//std::cout << rps << chkID;
-	//std::cout << DOdevs[0];
-	//std::cout << *VT_ptr[0];
-
-	// Get number of buttons by calling the method in the object
-	int butt_no = c->GetButtonNum();
-
-	// Normalize the values
-	axes[0] = c->XJoy();	// Axes
-	axes[1] = c->YJoy();
-	axes[2] = c->ZJoy();
-	axes[3] = c->RXJoy();
-	axes[4] = c->RYJoy();
-	axes[5] = c->RZJoy();
-
-	slider[0] = c->slid();		// Slider has noise 0.003967345693141f
-	povaim[0] = c->povdeg();	// POV Aim
-
-	// Take the button states, if true, it returns 1
-	for (int i = 0; i < 39; ++i) {
-		c->SetLEDOff(i);	// Set Led OFF when not pressed
-		buttons[i] = c->IsButtonPressed(i);
-		if (buttons[i] == 1) {
-			switch (i) {
-			case 2:
-				c->SetLEDPressYellow(1);
-				break;
-			case 3:
-				c->SetLEDPressRed(3);
-				break;
-			case 6:
-				c->SetLEDPressYellow(5);
-				break;
-			case 7:
-				c->SetLEDPressRed(7);
-				break;
-			case 19:
-				c->SetLEDPressYellow(15);
-				break;
-			case 20:
-				c->SetLEDPressYellow(15);
-				break;
-			case 21:
-				c->SetLEDPressRed(15);
-				break;
-			case 22:
-				c->SetLEDPressYellow(15);
-				break;
-			}
-			//printf("Buttons: %d, ", i);
-		}
-	}
-
-	// Print text to MDF
-	c->SetMDFTextAuto(int( *auto_ptr[0]), int(*VT_ptr[0]));
-
-
-}
-
-// Unacquire the DirectInput objct and free the memory that we allocate to make persistent object
-static void mdlTerminate(SimStruct* S) {
-	x52p_ctrl* c = (x52p_ctrl*)ssGetPWork(S)[0];	// Take the pointer to persistent object
-	c->UnacqDev();			// Unacquire
-	c->DirectOutputStop();	// Stop DirectOutput API
-	delete c;		// Free memory
-}
-
-#ifdef  MATLAB_MEX_FILE    // Is this file being compiled as a MEX-file?
-#include "simulink.c"      // MEX-file interface mechanism
-#else
-#include "cg_sfun.h"       // Code generation registration function 
+// ---------------------------------------------------------------------------------------------------------- //
+// Osaka University: Dimas M. Rachman, 2022.
+// C MEX S-Function for Simulink with two inputs and LED/MDF modification.
+// Saitek/Logitech x52 pro HOTAS.
+
+// REQUIREMENTS
+// A.	Make sure you have installed DirectX SDK https://www.microsoft.com/en-us/download/details.aspx?id=6812.
+//		This SDK providess the necessary headers like dinput.h and libraries like dinput8.lib, dxguid.lib.
+
+// B.	Download the DirectOutput API (.lib, .h, and .dll) https://1drv.ms/u/s!Aq8Kg0iqxkdrgfxXZBc5CL-a9-SAaQ.
+//		See https://forums.frontier.co.uk/threads/how-to-use-x52-pro-sdk-making-us-of-the-mfd-and-leds.428813/.
+//		Put the DirectOutput.lib, DirectOutput.h, and DirectOutput.dll in your folder.
+
+// C.	Necessary files to be in your folder (where your .slx present, or the referenced path):
+//			1. DirectOutput.lib, DirectOutput.h, and DirectOutput.dll
+//			2. x52p_ctrl.h the header file
+//			3. x52p_ctrl.cpp the function definition file
+//			4. This file
+
+// PARAMETERS
+//	1. Joystick ID: 0, 1, 2, ... (index of the game controller)
+//	2. Options: vector, the missing entries take the default, [] for all defaults
+//		1st, StartMode: 0 cold start (default), new device every run, a device kept by a warm start is released
+//		                1 warm start, the device is kept between runs (MEX locked), see WARM START in x52p_ctrl.cpp
+//		                To release all kept devices: munlock x52p_ctrl_SFun_wInput, then clear x52p_ctrl_SFun_wInput
+//		2nd, OutputRate: budget of DirectOutput calls (LEDs, MFD lines) per second, 0 for no budget (default)
+//		                 Warning LEDs go first, then the other LEDs, then the MFD, see OUTPUT SCHEDULER in x52p_ctrl.cpp
+//		3rd, OutputBurst: calls that can go at once within the budget, 8 by default
+//		4th, Scenario: 0 the HOTAS (default), 1 the script x52p_scenario.txt in the current folder instead
+//		               (no HOTAS needed, sampled at the simulation time), see Scenario in x52p_ctrl.h
+//		5th, PollPeriod: wall-clock seconds between two reads of the HOTAS at least, 0 for every step (default)
+//		6th, PollEvery: read the HOTAS every N steps at most, 1 by default. Both apply. Between the reads the
+//		                outputs hold, e.g. 0.002 and 1 for a model running much faster than real time.
+//		                The 6th output gives the effective reads per second.
+//		7th, PredictLead: seconds ahead for the 7th output (predicted X, Y, Z, RX, RY, RZ, slider), 0 by default
+//		8th, PredictAlpha, 9th, PredictBeta: gains of the predictor, 0.5 and 0.1 by default, see x52p_predict
+//		10th, ChangeThreshold: move of an axis (fraction of its range) that counts as a change, 0.008 by default,
+//		                       a quarter of it while the axis keeps moving, see x52p_gate. Buttons, POV, and mode
+//		                       count at any change. The 8th output is 1 in the steps with a change (for an enabled
+//		                       subsystem, function-call outputs must be the 1st port), the 9th tells what changed:
+//		                       bits 0 to 6 the axes and slider, 7 the POV, 8 the mode, 9 + i button i.
+//		11th, Config: 0 the built-in axes and button LEDs (default), 1 the file x52p_config.txt in the current
+//		              folder, reloaded while running when it is saved. A file with an error is not used (the
+//		              last good one stays), the reason is printed. See CONFIGURATION in x52p_ctrl.cpp
+//		12th, StallBound: seconds of failing reads of the HOTAS before the failsafe outputs, 0.02 by default, 0 off
+//		13th, FreezeBound: seconds of exactly the same state before the failsafe outputs, 0 (off) by default
+//		                   The failsafe centers X, Y, RZ and holds the others (set in the Config file), buttons
+//		                   released. The 10th output: 0 healthy, 1 failing reads (last good state held), 2 failsafe.
+//		                   See WATCHDOG in x52p_ctrl.cpp
+//		14th, SampleRate: samples per second of the HOTAS read by a thread of its own, 0 (off) by default
+//		15th, FrameSize: rows of the 11th output, 10 by default. Each step the 11th output gives the samples
+//		                 since the last step, one per row (oldest first): t (s since the start), X, Y, Z, RX, RY,
+//		                 RZ, slider, POV, buttons (bit i button i); the 12th output how many rows are valid, the
+//		                 other rows are 0. Samples over FrameSize stay for the next step, none is lost as long as
+//		                 FrameSize is more than SampleRate times the step, e.g. 1000 Hz with a step of 0.01: 12.
+//		                 With a Scenario it is sampled at SampleRate in simulation time instead.
+//		                 See SAMPLER in x52p_ctrl.cpp
+//		16th, AnalysisWindow: samples per window of the spectrum of the samples (PIO), 0 (off) by default,
+//		                      needs SampleRate, e.g. 2048 at 1000 Hz: 0.49 Hz resolution, a result every 1.02 s
+//		17th, BandLow, 18th, BandHigh: band of the spectrum in Hz, 0.5 and 5 by default
+//		                      The 13th output: band power (mean square) of roll X, pitch Y, yaw RZ, then their
+//		                      dominant frequency (Hz), then its amplitude, then the windows done so far.
+//		                      Computed on a thread of its own, see SPECTRUM in x52p_ctrl.cpp
+//		19th, RealTime: 0 off (default), otherwise each step is held until its wall-clock time: simulation time
+//		                divided by RealTime (1 real time, 2 twice as fast). Absolute deadlines from the start, no
+//		                drift; a high resolution timer then a spin of the last 0.2 ms, see X52SleepUntil(). A run
+//		                more than 0.1 s behind (paused, breakpoint) starts again from there instead of catching up.
+//		                The 14th output: overrun (s the step came after its deadline, the model is too slow),
+//		                lateness (s the step was released after its deadline). Use it in one block of the model.
+
+// HOW TO COMPILE (FOR MATLAB SIMULINK)
+// You need C++ compiler available in your system.
+// Be sure to set the compiler appropriately for C++, use "mex -setup" and choose accordingly.
+// Compile in Matlab with "mex x52p_ctrl_SFun_wInput.cpp".
+// This gives you a mexw64 file (Matlab executable file) in the folder, which is why the DirectOutput.dll
+//		should be in the same place with the executable file.
+// To see where the time goes in each step, compile with "mex -DX52P_TRACE x52p_ctrl_SFun_wInput.cpp":
+//		x52p_trace.json is written in the current folder at the end of each run, open it in https://ui.perfetto.dev
+//		With StartMode 1, the start latency (cold or warm) is also printed in the command window.
+// ---------------------------------------------------------------------------------------------------------- //
+
+
+#define S_FUNCTION_NAME  x52p_ctrl_SFun_wInput		// define S-Function Name
+#define S_FUNCTION_LEVEL 2							// define S-Function Level
+
+#include "simstruc.h"		// For Simulink S-Function
+#include "x52p_ctrl.cpp"	// Functions definitions
+
+// Entries of the options vector (2nd parameter), see PARAMETERS above
+enum Options { OPT_START_MODE, OPT_OUTPUT_RATE, OPT_OUTPUT_BURST, OPT_SCENARIO, OPT_POLL_PERIOD, OPT_POLL_EVERY,
+	OPT_PREDICT_LEAD, OPT_PREDICT_ALPHA, OPT_PREDICT_BETA, OPT_CHANGE_THRESHOLD, OPT_CONFIG,
+	OPT_STALL_BOUND, OPT_FREEZE_BOUND, OPT_SAMPLE_RATE, OPT_FRAME_SIZE,
+	OPT_ANALYSIS_WINDOW, OPT_BAND_LOW, OPT_BAND_HIGH, OPT_REAL_TIME, OPT_COUNT };
+
+const int FrameColumns = 10;	// t, X, Y, Z, RX, RY, RZ, slider, POV, buttons
+const long long PacingResyncNs = 100000000;	// Behind more than this: new start of the pacing, see RealTime
+
+// Get an entry of the options vector, def if the vector is shorter
+static real_T GetOption(SimStruct* S, int idx, real_T def) {
+	const mxArray* opts = ssGetSFcnParam(S, 1);
+	if ((size_t)idx >= mxGetNumberOfElements(opts)) {
+		return def;
+	}
+	return mxGetPr(opts)[idx];
+}
+
+// Check parameters, hmm still needs checking
+#define MDL_CHECK_PARAMETERS
+#if defined (MDL_CHECK_PARAMETERS) && defined(MATLAB_MEX_FILE)
+
+static void mdlCheckParameters(SimStruct* S) {
+	size_t NrParameters = mxGetNumberOfElements(ssGetSFcnParam(S, 0)); // Take number of element in the SFun param
+	real_T* joyid_param = (real_T*)mxGetPr(ssGetSFcnParam(S, 0)); // Take pointer of the SFun param, must be double, name it joystick_id
+
+	const char* msg = NULL; // allocate pointer for message of char with null/zeros
+
+	if (NrParameters != 1) { // If people enters array, check!
+		msg = "Put only one joystick ID, not an array.";
+	}
+	else { // The ID is the index of the game controller, every block can use its own device
+		if (joyid_param[0] < 0 || joyid_param[0] != int(joyid_param[0])) {
+			msg = "The joystick ID must be 0, 1, 2, ... (index of the game controller).";
+		}
+	}
+	if (msg == NULL) { // Check the options vector
+		if (!mxIsDouble(ssGetSFcnParam(S, 1)) || mxGetNumberOfElements(ssGetSFcnParam(S, 1)) > OPT_COUNT) {
+			msg = "The options must be a vector of numbers, see PARAMETERS in x52p_ctrl_SFun_wInput.cpp.";
+		}
+		else {
+			real_T startMode = GetOption(S, OPT_START_MODE, 0);
+			if (startMode != 0 && startMode != 1) {
+				msg = "StartMode (1st option) must be 0 (cold) or 1 (warm).";
+			}
+			else if (GetOption(S, OPT_OUTPUT_RATE, 0) < 0 || GetOption(S, OPT_OUTPUT_BURST, 8) < 1) {
+				msg = "OutputRate (2nd option) must be 0 or more, OutputBurst (3rd option) 1 or more.";
+			}
+			else if (GetOption(S, OPT_SCENARIO, 0) != 0 && GetOption(S, OPT_SCENARIO, 0) != 1) {
+				msg = "Scenario (4th option) must be 0 (HOTAS) or 1 (x52p_scenario.txt).";
+			}
+			else if (GetOption(S, OPT_POLL_PERIOD, 0) < 0 || GetOption(S, OPT_POLL_EVERY, 1) < 1 ||
+				GetOption(S, OPT_POLL_EVERY, 1) != int(GetOption(S, OPT_POLL_EVERY, 1))) {
+				msg = "PollPeriod (5th option) must be 0 or more, PollEvery (6th option) 1, 2, 3, ...";
+			}
+			else if (GetOption(S, OPT_PREDICT_LEAD, 0) < 0 || GetOption(S, OPT_PREDICT_ALPHA, 0.5) < 0 ||
+				GetOption(S, OPT_PREDICT_ALPHA, 0.5) > 1 || GetOption(S, OPT_PREDICT_BETA, 0.1) < 0 || GetOption(S, OPT_PREDICT_BETA, 0.1) > 1) {
+				msg = "PredictLead (7th option) must be 0 or more, PredictAlpha and PredictBeta (8th, 9th) 0 to 1.";
+			}
+			else if (GetOption(S, OPT_CHANGE_THRESHOLD, 0.008) < 0 || GetOption(S, OPT_CHANGE_THRESHOLD, 0.008) > 1) {
+				msg = "ChangeThreshold (10th option) must be 0 to 1.";
+			}
+			else if (GetOption(S, OPT_CONFIG, 0) != 0 && GetOption(S, OPT_CONFIG, 0) != 1) {
+				msg = "Config (11th option) must be 0 (built-in) or 1 (x52p_config.txt).";
+			}
+			else if (GetOption(S, OPT_STALL_BOUND, 0.02) < 0 || GetOption(S, OPT_FREEZE_BOUND, 0) < 0) {
+				msg = "StallBound and FreezeBound (12th, 13th options) must be 0 (off) or more.";
+			}
+			else if (GetOption(S, OPT_SAMPLE_RATE, 0) < 0 || GetOption(S, OPT_SAMPLE_RATE, 0) > 100000 ||
+				GetOption(S, OPT_FRAME_SIZE, 10) < 1 || GetOption(S, OPT_FRAME_SIZE, 10) > 10000 ||
+				GetOption(S, OPT_FRAME_SIZE, 10) != int(GetOption(S, OPT_FRAME_SIZE, 10))) {
+				msg = "SampleRate (14th option) must be 0 to 100000, FrameSize (15th option) 1 to 10000.";
+			}
+			else if (GetOption(S, OPT_ANALYSIS_WINDOW, 0) != 0 && (GetOption(S, OPT_SAMPLE_RATE, 0) == 0 ||
+				GetOption(S, OPT_ANALYSIS_WINDOW, 0) < 16 || GetOption(S, OPT_ANALYSIS_WINDOW, 0) > 65536 ||
+				GetOption(S, OPT_BAND_LOW, 0.5) < 0 || GetOption(S, OPT_BAND_HIGH, 5) <= GetOption(S, OPT_BAND_LOW, 0.5))) {
+				msg = "AnalysisWindow (16th option) must be 0, or 16 to 65536 with a SampleRate; BandHigh above BandLow.";
+			}
+			else if (GetOption(S, OPT_REAL_TIME, 0) < 0) {
+				msg = "RealTime (19th option) must be 0 (off) or more, 1 for real time.";
+			}
+		}
+	}
+	if (msg != NULL) { // Give error if and break Simulink if either message is coming
+		ssSetErrorStatus(S, msg);
+		return;
+	}
+}
+#endif 
+
+// Initialize the S-Function block parameter
+static void mdlInitializeSizes(SimStruct* S) {
+	ssSetNumSFcnParams(S, 2);	// Expect two parameters: joystick ID, default is 0 !!!, and options
+	if (ssGetNumSFcnParams(S) == ssGetSFcnParamsCount(S)) {
+		mdlCheckParameters(S);	// Run the check, if msg is coming, then break Simulink
+		if (ssGetErrorStatus(S) != NULL) {
+			return;
+		}
+	}
+	else { // If the number of parameters does not match, break Simulink
+		return;
+	}
+
+	ssSetNumContStates(S, 0);	// No continuous states
+	ssSetNumDiscStates(S, 0);	// No discrete states
+
+	if (!ssSetNumInputPorts(S, 2)) { // One input ports (Auto and VecTwin)
+		return; // Break Simulink if there are input ports
+	}
+
+	ssSetInputPortWidth(S, 0, 1); // 1st port: Auto 
+	ssSetInputPortWidth(S, 1, 1); // 2nd port: VecTwin
+	ssSetInputPortDirectFeedThrough(S, 0, 1);	// To make sure that the input is available!
+	ssSetInputPortDirectFeedThrough(S, 1, 1);	// To make sure that the input is available!
+
+	if (!ssSetNumOutputPorts(S, 14)) { // Outputs: axes, slider, pov, button, soft buttons, poll rate, predicted, changed, health, frame, spectrum, pacing
+		return; // Break Simulink if the number of output ports is not correct
+	}
+
+	ssSetOutputPortWidth(S, 0, 6);	// 1st port: Six axes X, Y, Z, and RX, RY, RZ
+	ssSetOutputPortWidth(S, 1, 1);	// 2nd port: One slider
+	ssSetOutputPortWidth(S, 2, 1);	// 3rd port: One PovAim
+	ssSetOutputPortWidth(S, 3, 39);	// 4th port: Thirty nine buttons
+	ssSetOutputPortWidth(S, 4, 3);	// 5th port: Soft button presses in this step: select, up, down
+	ssSetOutputPortWidth(S, 5, 1);	// 6th port: Reads of the HOTAS per second (wall clock), see PollPeriod
+	ssSetOutputPortWidth(S, 6, 7);	// 7th port: Axes and slider predicted PredictLead ahead
+	ssSetOutputPortWidth(S, 7, 1);	// 8th port: 1 when the state changed enough, see ChangeThreshold
+	ssSetOutputPortWidth(S, 8, 1);	// 9th port: What changed, bit mask
+	ssSetOutputPortWidth(S, 9, 1);	// 10th port: Health of the reads, see StallBound
+	ssSetOutputPortMatrixDimensions(S, 10, int(GetOption(S, OPT_FRAME_SIZE, 10)), FrameColumns);	// 11th port: Samples
+	ssSetOutputPortWidth(S, 11, 1);	// 12th port: Valid rows of the samples
+	ssSetOutputPortWidth(S, 12, 10);	// 13th port: Spectrum of roll, pitch, yaw: power, frequency, amplitude, windows
+	ssSetOutputPortWidth(S, 13, 2);		// 14th port: Overrun and lateness of the step, see RealTime
+	for (int i = 0; i < 7; ++i) {
+		if (i != 4 && i != 5) {
+			ssSetOutputPortOptimOpts(S, i, SS_NOT_REUSABLE_AND_GLOBAL);	// Held between the reads of the HOTAS
+		}
+	}
+
+	ssSetNumSampleTimes(S, -1);	// If sample time is inherited, use -1
+	ssSetNumPWork(S, 6);		// Set pointers for persistent objects! The x52p_ctrl, the scenario, the predictor, the gate, samples, timer
+	ssSetNumRWork(S, 3);		// Time of the next scenario sample, start of the pacing (simulation time, wall-clock ns)
+	ssSetNumIWork(S, 9);		// Last buttons (valid, low, high), MFD inputs (valid, auto, VecTwin), config rejects, stalls, paced
+	ssSetNumModes(S, 0);
+	ssSetNumNonsampledZCs(S, 0);
+
+	ssSetOperatingPointCompliance(S, USE_DEFAULT_OPERATING_POINT); // Misc for save/restore the Simulink
+}
+
+// Initialize the S-Function block parameter: sample time
+static void mdlInitializeSampleTimes(SimStruct* S) {
+	ssSetSampleTime(S, 0, INHERITED_SAMPLE_TIME);	// Set to inherit the simulink
+	ssSetOffsetTime(S, 0, 0.0);	// No offset
+}
+
+// Warm start: the MEX file is locked while a device is kept, so "clear mex" cannot lose it.
+// Released with StartMode 0, or all of them when the MEX file is unloaded (munlock then clear, or MATLAB exits)
+static int warmLocked = 0;
+
+static void WarmStartExit() {
+	WarmStartRelease(-1);
+}
+
+static void WarmStartLock() {
+	if (!warmLocked && WarmStartCount() > 0) {
+		mexAtExit(WarmStartExit);
+		mexLock();
+		warmLocked = 1;
+	}
+	else if (warmLocked && WarmStartCount() == 0) {
+		mexUnlock();
+		warmLocked = 0;
+	}
+}
+
+// Callback to initialize initial state just once! Make persist the DirectInput object
+#define MDL_START 
+#if defined(MDL_START) 
+static void mdlStart(SimStruct* S) {
+	// Get the S-Function parameter, here is the joystick ID
+	real_T* joyid_param = (real_T*)mxGetPr(ssGetSFcnParam(S, 0));
+	// int joyid_chk = int(joyid_param[0]); // For debugging
+	// std::cout << joyid_chk;
+
+	int id = int(joyid_param[0]);
+	int startMode = int(GetOption(S, OPT_START_MODE, 0));
+#ifdef X52P_TRACE
+	long long t0 = x52p_now_ns();	// Measure the start latency
+#endif
+
+	// Warm start: take the device kept by the last run (reset with a diff), cold start: release it
+	x52p_ctrl* c = NULL;
+	if (startMode == 1) {
+		c = WarmStartTake(id);
+	}
+	else {
+		WarmStartRelease(id);
+	}
+	WarmStartLock();
+#ifdef X52P_TRACE
+	int warm = (c != NULL);
+#endif
+
+	// Use PWork (pointer that points to a vector of pointers)
+	// to make DirectInput object persist (and DirectOutput)
+	// Create the object x52p_ctrl with joystick_id, each block owns its device (DirectInput and DirectOutput)
+	void** PWork = ssGetPWork(S);
+	if (c == NULL) {
+		c = new x52p_ctrl(id);	// allocate memory with new
+	}
+	PWork[0] = (void*)c;
+	PWork[1] = NULL;
+	x52p_predict* pred = new x52p_predict;	// Allocated here, not in the steps
+	pred->SetGains(GetOption(S, OPT_PREDICT_ALPHA, 0.5), GetOption(S, OPT_PREDICT_BETA, 0.1));
+	PWork[2] = (void*)pred;
+	x52p_gate* gate = new x52p_gate;
+	unsigned short enter = (unsigned short)(GetOption(S, OPT_CHANGE_THRESHOLD, 0.008) * 65535 + 0.5);
+	gate->SetThresholds(enter, enter / 4);
+	PWork[3] = (void*)gate;
+	PWork[4] = (void*)new X52Sample[int(GetOption(S, OPT_FRAME_SIZE, 10))];	// One frame, see FillFrame()
+	PWork[5] = (GetOption(S, OPT_REAL_TIME, 0) > 0) ? (void*)X52CreateTimer() : NULL;	// Off: nothing made
+	ssGetIWork(S)[8] = 0;	// The pacing starts at the first step
+	ssGetRWork(S)[0] = 0;
+	ssGetIWork(S)[0] = 0;	// LEDs and MFD written at the first step
+	ssGetIWork(S)[3] = 0;
+	c->SetPollDecimation(GetOption(S, OPT_POLL_PERIOD, 0), int(GetOption(S, OPT_POLL_EVERY, 1)));
+	c->SetOutputBudget(GetOption(S, OPT_OUTPUT_RATE, 0), int(GetOption(S, OPT_OUTPUT_BURST, 8)));
+
+	// Axes and button LEDs from the file, watched while running (a warm device may still have the last one)
+	c->StopConfigWatch();
+	int loaded = c->LoadConfig(NULL);
+	ssGetIWork(S)[6] = c->GetConfigRejects();
+	c->SetWatchdog(GetOption(S, OPT_STALL_BOUND, 0.02), GetOption(S, OPT_FREEZE_BOUND, 0));
+	ssGetIWork(S)[7] = 0;
+	if (int(GetOption(S, OPT_CONFIG, 0)) == 1) {
+		loaded = c->WatchConfig("x52p_config.txt");
+		if (loaded == 0) {
+			static char msg[160];	// Kept by Simulink after the return
+			c->GetConfigError(msg, sizeof(msg));
+			ssSetErrorStatus(S, msg);
+			return;
+		}
+	}
+	if (loaded < 0) {	// Last run's tables still held, the previous configuration stays until the first steps
+		char why[160];
+		c->GetConfigError(why, sizeof(why));
+		ssPrintf("x52p_ctrl: configuration not loaded yet, %s\n", why);
+	}
+
+	// Scripted input instead of the HOTAS
+	c->SetScenario(NULL);
+	if (int(GetOption(S, OPT_SCENARIO, 0)) == 1) {
+		x52p_scenario* sc = new x52p_scenario;
+		PWork[1] = (void*)sc;
+		if (!sc->LoadFile("x52p_scenario.txt")) {
+			static char msg[160];	// Kept by Simulink after the return
+			snprintf(msg, sizeof(msg), "%s", sc->GetError());
+			ssSetErrorStatus(S, msg);
+			return;
+		}
+		c->SetScenario(sc);
+		return;	// No game controller needed
+	}
+
+#ifdef X52P_TRACE
+	if (startMode == 1) {	// The first run is cold, the next ones warm: compare the latencies
+		ssPrintf("x52p_ctrl: joystick %d, %s start in %.1f ms\n", id, warm ? "warm" : "cold", (x52p_now_ns() - t0) * 1e-6);
+	}
+#endif
+
+	// Check and give error if there is no game controller with this ID
+	if (c->GetDevID() >= c->GetDevCount()) {
+		ssSetErrorStatus(S, "No game controller with this joystick ID, is the HOTAS connected?");
+		return;
+	}
+	int frame = int(GetOption(S, OPT_FRAME_SIZE, 10));
+	c->SetAnalysis(int(GetOption(S, OPT_ANALYSIS_WINDOW, 0)), GetOption(S, OPT_BAND_LOW, 0.5), GetOption(S, OPT_BAND_HIGH, 5));
+	c->StartSampler(GetOption(S, OPT_SAMPLE_RATE, 0), 4 * frame);	// A few steps late before a sample is lost
+}
+#endif
+
+// The 11th and 12th outputs: the samples since the last step, from the sampler thread or the scenario
+static void FillFrame(SimStruct* S, x52p_ctrl* c) {
+	real_T* frame = (real_T*)ssGetOutputPortRealSignal(S, 10);
+	real_T* rows = (real_T*)ssGetOutputPortRealSignal(S, 11);
+	int frameSize = int(GetOption(S, OPT_FRAME_SIZE, 10));
+	double rate = GetOption(S, OPT_SAMPLE_RATE, 0);
+	X52Sample* samples = (X52Sample*)ssGetPWork(S)[4];
+	x52p_scenario* sc = (x52p_scenario*)ssGetPWork(S)[1];
+	int n = 0;
+	double t0 = 0;
+	if (sc != NULL && rate > 0) {	// Simulation time, from where the last step stopped
+		real_T* next = &ssGetRWork(S)[0];
+		for (; n < frameSize && *next <= ssGetT(S); ++n) {
+			samples[n].time = (long long)(*next * 1e9);
+			sc->Sample(*next, &samples[n].state);
+			*next += 1.0 / rate;
+		}
+	}
+	else {
+		n = c->ReadSamples(samples, frameSize);
+		t0 = c->GetSamplerStart() * 1e-9;
+	}
+
+	// Column-major: element (row, column) at column * frameSize + row
+	for (int r = 0; r < frameSize; ++r) {
+		double axes[AxisCount] = { 0 };
+		if (r < n) {
+			c->NormalizeAxes(&samples[r].state, axes);
+		}
+		frame[r] = (r < n) ? samples[r].time * 1e-9 - t0 : 0;
+		for (int a = 0; a < AxisCount; ++a) {
+			frame[(a + 1) * frameSize + r] = axes[a];
+		}
+		frame[8 * frameSize + r] = (r < n) ? X52PovDeg(&samples[r].state) : 0;
+		frame[9 * frameSize + r] = (r < n) ? (real_T)samples[r].state.buttons : 0;	// 39 bits, exact in a double
+	}
+	rows[0] = n;
+}
+
+// The 14th output: hold the step until its wall-clock time, see RealTime
+// The deadline is from the start of the pacing, a late step does not move the next ones (no drift)
+static void Pace(SimStruct* S) {
+	real_T* pacing = (real_T*)ssGetOutputPortRealSignal(S, 13);
+	double factor = GetOption(S, OPT_REAL_TIME, 0);
+	if (factor <= 0) {
+		pacing[0] = pacing[1] = 0;
+		return;
+	}
+	X52P_TRACE_SCOPE("pacing");
+	real_T* rwork = ssGetRWork(S);
+	long long now = x52p_now_ns();
+	long long deadline = now;
+	if (ssGetIWork(S)[8]) {
+		deadline = (long long)rwork[2] + (long long)((ssGetT(S) - rwork[1]) / factor * 1e9);
+	}
+	if (!ssGetIWork(S)[8] || now - deadline > PacingResyncNs) {
+		ssGetIWork(S)[8] = 1;	// First step, or far behind: this step is on time
+		rwork[1] = ssGetT(S);
+		rwork[2] = (real_T)now;	// ns, exact in a double for 104 days
+		deadline = now;
+	}
+	pacing[0] = (now > deadline) ? (now - deadline) * 1e-9 : 0;
+	X52SleepUntil(deadline, (HANDLE)ssGetPWork(S)[5], SamplerSpinNs);
+	pacing[1] = (x52p_now_ns() - deadline) * 1e-9;
+}
+
+// Update the output: the state of the Joystick
+static void mdlOutputs(SimStruct* S, int_T tid) {
+	// Get the output of SFun to be used in Simulink, everything is double
+	// Convert to the appropriate data type to a pointer
+	real_T* axes = (real_T*)ssGetOutputPortRealSignal(S, 0);
+	real_T* slider = (real_T*)ssGetOutputPortRealSignal(S, 1);
+	real_T* povaim = (real_T*)ssGetOutputPortRealSignal(S, 2);
+	real_T* buttons = (real_T*)ssGetOutputPortRealSignal(S, 3);
+	real_T* softbtn = (real_T*)ssGetOutputPortRealSignal(S, 4);
+	real_T* pollrate = (real_T*)ssGetOutputPortRealSignal(S, 5);
+	real_T* predicted = (real_T*)ssGetOutputPortRealSignal(S, 6);
+	real_T* changed = (real_T*)ssGetOutputPortRealSignal(S, 7);
+	real_T* changemask = (real_T*)ssGetOutputPortRealSignal(S, 8);
+	real_T* health = (real_T*)ssGetOutputPortRealSignal(S, 9);
+	int_T* iwork = ssGetIWork(S);
+
+	// Get the input of SFun to be used here, all double
+	InputRealPtrsType auto_ptr = ssGetInputPortRealSignalPtrs(S, 0);
+	InputRealPtrsType VT_ptr = ssGetInputPortRealSignalPtrs(S, 1);
+
+	// Take the pointer to the persistent DirectInput object from the pointer vectors, name it c.
+	x52p_ctrl* c = (x52p_ctrl*)ssGetPWork(S)[0];
+	X52P_TRACE_SCOPE("mdlOutputs");
+	Pace(S);	// Before the read, the HOTAS is read at the wall-clock time of the step
+
+	// Update the state by calling the method in the object, only when a read is due (see PollPeriod)
+	c->SetSimTime(ssGetT(S));	// Used by a scenario only
+	int polled = c->Poll();
+
+	// DEBUGGING, MAKE PUBLIC ALL CLASS VARIABLES
+	//std::cout << c->thejoys.x52p_devs;	// Print out the DirecInput object, should persist each time step
+	//std::cout << c->joystick_id;			// For debuggin please always make public the class variables in the x52p_ctrl.h
+	//std::cout << &c->state.lX << &c->state;
+	//bool rsp = c->IsDevConnected();
+	//int chkID = c->GetDevID();
+	//std::cout << rps << chkID;
+	//std::cout << *VT_ptr[0];
+
+	// Get number of buttons by calling the method in the object
+	int butt_no = c->GetButtonNum();
+
+	// Change gate: nothing changes between the polls
+	unsigned long long fields = polled ? ((x52p_gate*)ssGetPWork(S)[3])->Update(&c->GetCompactState()) : 0;
+	changed[0] = (fields != 0);
+	changemask[0] = (real_T)fields;	// 48 bits, exact in a double
+
+	// Between the polls the outputs keep their values (not reusable), nothing else to do for the stick
+	if (polled) {
+		// Normalize the values
+		{
+			X52P_TRACE_SCOPE("normalize");
+			axes[0] = c->XJoy();	// Axes
+			axes[1] = c->YJoy();
+			axes[2] = c->ZJoy();
+			axes[3] = c->RXJoy();
+			axes[4] = c->RYJoy();
+			axes[5] = c->RZJoy();
+
+			slider[0] = c->slid();		// Slider has noise 0.003967345693141f
+			povaim[0] = c->povdeg();	// POV Aim
+		}
+
+		// Prediction of the axes and slider, from the time of this read
+		{
+			x52p_predict* pred = (x52p_predict*)ssGetPWork(S)[2];
+			double now[AxisCount] = { axes[0], axes[1], axes[2], axes[3], axes[4], axes[5], slider[0] };
+			pred->Update(now, c->GetStateTime());
+			pred->Predict(GetOption(S, OPT_PREDICT_LEAD, 0), predicted);
+		}
+
+		// Take the button states, if true, it returns 1
+		// The LEDs only follow the buttons, nothing to do when the buttons did not change
+		unsigned long long mask = c->GetButtonMask();
+		if (!iwork[0] || (unsigned int)iwork[1] != (unsigned int)mask || (unsigned int)iwork[2] != (unsigned int)(mask >> 32)) {
+			X52P_TRACE_SCOPE("buttons and LEDs");
+			iwork[0] = 1;
+			iwork[1] = (int_T)(unsigned int)mask;
+			iwork[2] = (int_T)(unsigned int)(mask >> 32);
+			for (int i = 0; i < 39; ++i) {
+				buttons[i] = c->IsButtonPressed(i);
+			}
+			c->ShowButtonLEDs();	// The LEDs of the pressed buttons, see Config
+		}
+	}
+
+	// Print text to MDF, only when the inputs changed
+	int autoflg = int(*auto_ptr[0]), VecTflg = int(*VT_ptr[0]);
+	if (!iwork[3] || autoflg != iwork[4] || VecTflg != iwork[5]) {
+		c->SetMDFTextAuto(autoflg, VecTflg);
+		iwork[3] = 1;
+		iwork[4] = autoflg;
+		iwork[5] = VecTflg;
+	}
+
+	// Soft button presses queued by the DirectOutput callback since the last step
+	// Non-zero only in the steps where the wheel moved, e.g. to enable a menu subsystem
+	int counts[3];
+	c->GetSoftButtonCounts(counts);
+	softbtn[0] = counts[0];	// Select (wheel click)
+	softbtn[1] = counts[1];	// Scroll up
+	softbtn[2] = counts[2];	// Scroll down
+
+	c->PumpOutputs();	// LED/MFD writes that waited for the output budget, every step: tokens come back with time
+	pollrate[0] = c->GetPollRate();
+	health[0] = c->GetHealth();
+	FillFrame(S, c);
+
+	// Spectrum, the last window done by the analysis thread (zeros before the first)
+	real_T* spectrum = (real_T*)ssGetOutputPortRealSignal(S, 12);
+	X52Spectrum sp;
+	if (!c->GetSpectrum(&sp)) {
+		memset(&sp, 0, sizeof(sp));
+	}
+	for (int a = 0; a < SpectrumAxes; ++a) {
+		spectrum[a] = sp.power[a];
+		spectrum[3 + a] = sp.freq[a];
+		spectrum[6 + a] = sp.amp[a];
+	}
+	spectrum[9] = (real_T)sp.windows;
+	if (c->GetStallCount() != iwork[7]) {	// Once per stall, not every step
+		iwork[7] = c->GetStallCount();
+		ssPrintf("x52p_ctrl: HOTAS stalled at t = %.3f s (HRESULT 0x%08X), failsafe outputs\n", ssGetT(S), (unsigned int)c->GetLastResult());
+	}
+
+	// A saved x52p_config.txt with an error: the last good one stays, tell why once
+	int rejects = c->GetConfigRejects();
+	if (rejects != iwork[6]) {
+		iwork[6] = rejects;
+		char why[160];
+		c->GetConfigError(why, sizeof(why));
+		ssPrintf("x52p_ctrl: x52p_config.txt not used, %s\n", why);
+	}
+
+}
+
+// Unacquire the DirectInput objct and free the memory that we allocate to make persistent object
+static void mdlTerminate(SimStruct* S) {
+	X52P_TRACE_EXPORT("x52p_trace.json");	// Events of this run, compiled with X52P_TRACE only
+	x52p_ctrl* c = (x52p_ctrl*)ssGetPWork(S)[0];	// Take the pointer to persistent object
+	delete (x52p_scenario*)ssGetPWork(S)[1];	// The scenario, if any
+	ssGetPWork(S)[1] = NULL;
+	delete (x52p_predict*)ssGetPWork(S)[2];
+	ssGetPWork(S)[2] = NULL;
+	delete (x52p_gate*)ssGetPWork(S)[3];
+	ssGetPWork(S)[3] = NULL;
+	delete[] (X52Sample*)ssGetPWork(S)[4];
+	ssGetPWork(S)[4] = NULL;
+	if (ssGetPWork(S)[5] != NULL) {
+		CloseHandle((HANDLE)ssGetPWork(S)[5]);	// Timer of the pacing
+	}
+	ssGetPWork(S)[5] = NULL;
+	if (c == NULL) {
+		return;
+	}
+	c->StopSampler();
+	c->SetScenario(NULL);
+	c->StopConfigWatch();	// The file is watched again at the next start
+	if (int(GetOption(S, OPT_START_MODE, 0)) == 1 && c->GetDevID() < c->GetDevCount()) {
+		WarmStartKeep(c);	// Warm start: stays acquired with DirectOutput running for the next run
+		WarmStartLock();
+		return;
+	}
+	c->UnacqDev();			// Unacquire
+	c->DirectOutputStop();	// Stop DirectOutput API
+	delete c;		// Free memory
+}
+
+#ifdef  MATLAB_MEX_FILE    // Is this file being compiled as a MEX-file?
+#include "simulink.c"      // MEX-file interface mechanism
+#else
+#include "cg_sfun.h"       // Code generation registration function 
 #endif
\ No newline at end of file
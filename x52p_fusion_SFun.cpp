@@ -0,0 +1,237 @@
+// ---------------------------------------------------------------------------------------------------------- //
+// Osaka University: Dimas M. Rachman, 2022.
+// C MEX S-Function for Simulink, several game controllers (x52 pro, rudder pedals, panels) in one block.
+// Saitek/Logitech x52 pro HOTAS.
+
+// REQUIREMENTS
+// Same as x52p_ctrl_SFun.cpp: DirectX SDK, DirectOutput files, x52p_ctrl.h, x52p_ctrl.cpp, and this file.
+
+// HOW TO COMPILE
+// Compile in Matlab with "mex x52p_fusion_SFun.cpp", see x52p_ctrl_SFun.cpp.
+
+// PARAMETERS
+// 1. Layout: one row per output channel, [joystickID kind index gain]
+//		kind 0: axis, index 0 X, 1 Y, 2 Z, 3 RX, 4 RY, 5 RZ, 6 slider (normalized as the other blocks), times gain
+//		kind 1: button, index 0 to 38, gain when pressed and 0 when not
+//		kind 2: POV aim in degrees (-1000 centered), index and gain unused
+//		e.g. [0 0 0 1; 0 0 1 1; 1 0 5 1; 0 1 0 1] X and Y of the x52 pro (ID 0), rudder of the pedals (ID 1), trigger
+//		Every joystick ID in the layout is a source, read once per step, in the order of their first row.
+//		The sources are opened DirectInput only and share one DirectInput (OPEN_INPUT_SHARED): the MFD and LEDs
+//		of a x52 pro in the layout stay free for a x52p_ctrl_SFun block.
+// 2. Options: [SkewBound Threaded], shorter vectors take the defaults
+//		SkewBound: seconds a step waits for the reads at most (default 0.002)
+//		Threaded: 1 reads the sources in parallel, one thread each (default), 0 one after the other in the step
+
+// OUTPUTS
+// 1. The channels of the layout
+// 2. Skew of each source (s): how much older its state is than the newest source of the step, in the order of
+//	  the sources. A source read later than SkewBound gives its last state and its skew grows.
+// 3. Number of sources read within SkewBound in this step
+// ---------------------------------------------------------------------------------------------------------- //
+
+
+#define S_FUNCTION_NAME  x52p_fusion_SFun	// define S-Function Name
+#define S_FUNCTION_LEVEL 2					// define S-Function Level
+
+#include "simstruc.h"		// For Simulink S-Function
+#include "x52p_ctrl.cpp"	// Functions definitions
+
+// Get an entry of the options vector, def if the vector is shorter
+static real_T GetOption(SimStruct* S, int idx, real_T def) {
+	const mxArray* opts = ssGetSFcnParam(S, 1);
+	if ((size_t)idx >= mxGetNumberOfElements(opts)) {
+		return def;
+	}
+	return mxGetPr(opts)[idx];
+}
+
+// Joystick IDs of the layout in the order of their first row, returns how many, -1 if more than FusionMaxSources
+static int GetSourceIds(SimStruct* S, int ids[FusionMaxSources]) {
+	const mxArray* layout = ssGetSFcnParam(S, 0);
+	size_t rows = mxGetM(layout);
+	real_T* p = mxGetPr(layout);
+	int count = 0;
+	for (size_t r = 0; r < rows; ++r) {
+		int id = int(p[r]);	// 1st column
+		int k = 0;
+		while (k < count && ids[k] != id) {
+			++k;
+		}
+		if (k == count) {
+			if (count == FusionMaxSources) {
+				return -1;
+			}
+			ids[count++] = id;
+		}
+	}
+	return count;
+}
+
+// Check parameters
+#define MDL_CHECK_PARAMETERS
+#if defined (MDL_CHECK_PARAMETERS) && defined(MATLAB_MEX_FILE)
+
+static void mdlCheckParameters(SimStruct* S) {
+	const mxArray* layout = ssGetSFcnParam(S, 0);
+	const char* msg = NULL;
+
+	if (!mxIsDouble(layout) || mxGetN(layout) != 4 || mxGetM(layout) < 1 || mxGetM(layout) > FusionMaxChannels) {
+		msg = "The layout must be a matrix of 4 columns [joystickID kind index gain], one row per channel (256 at most).";
+	}
+	else {
+		size_t rows = mxGetM(layout);
+		real_T* p = mxGetPr(layout);	// Column by column
+		int ids[FusionMaxSources];
+		for (size_t r = 0; r < rows && msg == NULL; ++r) {
+			real_T id = p[r], kind = p[r + rows], index = p[r + 2 * rows];
+			if (id < 0 || id != int(id)) {
+				msg = "The joystick IDs (1st column) must be 0, 1, 2, ... (index of the game controller).";
+			}
+			else if (kind != FUSE_AXIS && kind != FUSE_BUTTON && kind != FUSE_HAT) {
+				msg = "The kind (2nd column) must be 0 (axis), 1 (button), or 2 (POV).";
+			}
+			else if ((kind == FUSE_AXIS && (index < 0 || index >= AxisCount || index != int(index))) ||
+				(kind == FUSE_BUTTON && (index < 0 || index >= ButtonCount || index != int(index)))) {
+				msg = "The index (3rd column) must be 0 to 6 for an axis, 0 to 38 for a button.";
+			}
+		}
+		if (msg == NULL && GetSourceIds(S, ids) < 0) {
+			msg = "At most 8 joystick IDs in the layout.";
+		}
+	}
+	if (msg == NULL) {
+		if (!mxIsDouble(ssGetSFcnParam(S, 1)) || mxGetNumberOfElements(ssGetSFcnParam(S, 1)) > 2) {
+			msg = "The options must be [SkewBound Threaded], see PARAMETERS in x52p_fusion_SFun.cpp.";
+		}
+		else if (GetOption(S, 0, 0.002) < 0) {
+			msg = "SkewBound (1st option) must be 0 or more.";
+		}
+		else if (GetOption(S, 1, 1) != 0 && GetOption(S, 1, 1) != 1) {
+			msg = "Threaded (2nd option) must be 0 or 1.";
+		}
+	}
+	if (msg != NULL) {
+		ssSetErrorStatus(S, msg);
+		return;
+	}
+}
+#endif
+
+// Initialize the S-Function block parameter
+static void mdlInitializeSizes(SimStruct* S) {
+	ssSetNumSFcnParams(S, 2);	// Layout and options
+	if (ssGetNumSFcnParams(S) == ssGetSFcnParamsCount(S)) {
+		mdlCheckParameters(S);
+		if (ssGetErrorStatus(S) != NULL) {
+			return;
+		}
+	}
+	else {
+		return;
+	}
+
+	ssSetNumContStates(S, 0);
+	ssSetNumDiscStates(S, 0);
+
+	if (!ssSetNumInputPorts(S, 0)) {
+		return;
+	}
+
+	if (!ssSetNumOutputPorts(S, 3)) { // Channels, skew, sources read in time
+		return;
+	}
+
+	int ids[FusionMaxSources];
+	ssSetOutputPortWidth(S, 0, (int_T)mxGetM(ssGetSFcnParam(S, 0)));	// 1st port: one per row of the layout
+	ssSetOutputPortWidth(S, 1, GetSourceIds(S, ids));					// 2nd port: one per source
+	ssSetOutputPortWidth(S, 2, 1);										// 3rd port: sources read in time
+
+	ssSetNumSampleTimes(S, -1);
+	ssSetNumPWork(S, 1 + FusionMaxSources);	// x52p_fusion, then the x52p_ctrl of each source
+	ssSetNumModes(S, 0);
+	ssSetNumNonsampledZCs(S, 0);
+
+	ssSetOperatingPointCompliance(S, USE_DEFAULT_OPERATING_POINT);
+}
+
+static void mdlInitializeSampleTimes(SimStruct* S) {
+	ssSetSampleTime(S, 0, INHERITED_SAMPLE_TIME);
+	ssSetOffsetTime(S, 0, 0.0);
+}
+
+// One x52p_ctrl per joystick ID (DirectInput only, one enumeration for all), all read by one x52p_fusion
+#define MDL_START
+#if defined(MDL_START)
+static void mdlStart(SimStruct* S) {
+	void** PWork = ssGetPWork(S);
+	int ids[FusionMaxSources];
+	int count = GetSourceIds(S, ids);
+	x52p_fusion* f = new x52p_fusion;
+	PWork[0] = (void*)f;
+	for (int i = 0; i < FusionMaxSources; ++i) {
+		PWork[1 + i] = NULL;
+	}
+	for (int i = 0; i < count; ++i) {
+		x52p_ctrl* c = new x52p_ctrl(ids[i], OPEN_INPUT_SHARED);
+		PWork[1 + i] = (void*)c;
+		f->AddSource(c);
+		if (c->GetDevID() >= c->GetDevCount()) {
+			ssSetErrorStatus(S, "No game controller with a joystick ID of the layout, are they all connected?");
+			return;
+		}
+	}
+
+	// Channels with the source index instead of the joystick ID
+	const mxArray* layout = ssGetSFcnParam(S, 0);
+	size_t rows = mxGetM(layout);
+	real_T* p = mxGetPr(layout);
+	FusionChannel* channels = new FusionChannel[rows];
+	for (size_t r = 0; r < rows; ++r) {
+		int source = 0;
+		while (ids[source] != int(p[r])) {
+			++source;
+		}
+		channels[r].source = source;
+		channels[r].kind = int(p[r + rows]);
+		channels[r].index = (channels[r].kind == FUSE_HAT) ? 0 : int(p[r + 2 * rows]);
+		channels[r].gain = p[r + 3 * rows];
+	}
+	f->SetLayout(channels, (int)rows);
+	delete[] channels;
+	f->Start(int(GetOption(S, 1, 1)), GetOption(S, 0, 0.002));
+}
+#endif
+
+// Read all the sources together
+static void mdlOutputs(SimStruct* S, int_T tid) {
+	real_T* out = (real_T*)ssGetOutputPortRealSignal(S, 0);
+	real_T* skew = (real_T*)ssGetOutputPortRealSignal(S, 1);
+	real_T* fresh = (real_T*)ssGetOutputPortRealSignal(S, 2);
+
+	x52p_fusion* f = (x52p_fusion*)ssGetPWork(S)[0];
+	fresh[0] = f->Step(out);
+	for (int i = 0; i < f->GetSourceNum(); ++i) {
+		skew[i] = f->GetSkew(i);
+	}
+}
+
+// Stop the reading threads before the devices go
+static void mdlTerminate(SimStruct* S) {
+	void** PWork = ssGetPWork(S);
+	delete (x52p_fusion*)PWork[0];
+	PWork[0] = NULL;
+	for (int i = 0; i < FusionMaxSources; ++i) {
+		x52p_ctrl* c = (x52p_ctrl*)PWork[1 + i];
+		if (c != NULL) {
+			c->UnacqDev();
+			delete c;
+		}
+		PWork[1 + i] = NULL;
+	}
+}
+
+#ifdef  MATLAB_MEX_FILE    // Is this file being compiled as a MEX-file?
+#include "simulink.c"      // MEX-file interface mechanism
+#else
+#include "cg_sfun.h"       // Code generation registration function
+#endif
@@ -0,0 +1,112 @@
+// ---------------------------------------------------------------------------------------------------------- //
+// Osaka University: Dimas M. Rachman, 2022.
+// Offline evaluation of the axis predictor (x52p_predict) on recorded sessions.
+// Saitek/Logitech x52 pro HOTAS.
+
+// REQUIREMENTS
+// Same as TESTWORKX52P.cpp: x52p_ctrl.h, x52p_ctrl.cpp, and the DirectX SDK and DirectOutput files to compile.
+// No HOTAS is needed to run it.
+
+// RECORDED SESSION
+// A CSV file, one sample per line: time (s), X, Y, Z, RX, RY, RZ, slider (normalized, as the S-Function outputs)
+// e.g. log the 1st and 2nd outputs of x52p_ctrl_SFun_wInput with the time, then writematrix([t axes slider], "s.csv").
+// Lines that do not start with a number (a header) are skipped.
+
+// HOW TO USE
+// x52p_predict_eval session.csv [alpha beta]
+// For each lead time, every sample is predicted lead ahead and compared to the recorded value at that time
+// (interpolated). The error of holding the last sample (no prediction) is shown next to it.
+// ---------------------------------------------------------------------------------------------------------- //
+
+#include "x52p_ctrl.h"				// External dependency file, header file
+#include "x52p_ctrl.cpp"			// Functions definitions
+
+const int MaxSamples = 4000000;		// About an hour at 1 kHz
+const double leads[] = { 0.0, 0.005, 0.010, 0.020, 0.040, 0.080 };	// Lead times to evaluate (s)
+const int LeadCount = sizeof(leads) / sizeof(leads[0]);
+
+static double times[MaxSamples];
+static double samples[MaxSamples][AxisCount];
+
+// Read the session, returns the number of samples
+int ReadSession(const char* path) {
+	FILE* f = fopen(path, "r");
+	if (f == NULL) {
+		return 0;
+	}
+	int n = 0;
+	char line[512];
+	while (n < MaxSamples && fgets(line, sizeof(line), f) != NULL) {
+		double v[AxisCount + 1];
+		int got = sscanf(line, "%lf,%lf,%lf,%lf,%lf,%lf,%lf,%lf", &v[0], &v[1], &v[2], &v[3], &v[4], &v[5], &v[6], &v[7]);
+		if (got != AxisCount + 1 || (n > 0 && v[0] <= times[n - 1])) {
+			continue;	// Header, short line, or time not increasing
+		}
+		times[n] = v[0];
+		for (int a = 0; a < AxisCount; ++a) {
+			samples[n][a] = v[a + 1];
+		}
+		++n;
+	}
+	fclose(f);
+	return n;
+}
+
+int main(int argc, char** argv) {
+	if (argc != 2 && argc != 4) {
+		printf("Usage: x52p_predict_eval session.csv [alpha beta]\n");
+		return 1;
+	}
+	int n = ReadSession(argv[1]);
+	if (n < 2) {
+		printf("No samples in %s\n", argv[1]);
+		return 1;
+	}
+	double alpha = (argc == 4) ? atof(argv[2]) : 0.5;
+	double beta = (argc == 4) ? atof(argv[3]) : 0.1;
+	printf("%d samples, %.1f s, alpha %.3f beta %.3f\n", n, times[n - 1] - times[0], alpha, beta);
+	printf("lead (ms)  RMS hold   RMS pred   max pred   | RMS pred per axis: X Y Z RX RY RZ slider\n");
+
+	static const char* const names[AxisCount] = { "X", "Y", "Z", "RX", "RY", "RZ", "slider" };
+	for (int l = 0; l < LeadCount; ++l) {
+		x52p_predict pred;
+		pred.SetGains(alpha, beta);
+		double sumHold = 0, sumPred = 0, maxPred = 0, sumAxis[AxisCount] = { 0 };
+		long long count = 0;
+		int j = 0;		// Recorded sample at or before the target time
+		for (int i = 0; i < n; ++i) {
+			pred.Update(samples[i], (long long)(times[i] * 1e9));
+			double target = times[i] + leads[l];
+			while (j + 1 < n && times[j + 1] <= target) {
+				++j;
+			}
+			if (j + 1 >= n) {
+				break;	// No recorded value that late
+			}
+			double w = (target - times[j]) / (times[j + 1] - times[j]);
+			double out[AxisCount];
+			pred.Predict(leads[l], out);
+			for (int a = 0; a < AxisCount; ++a) {
+				double actual = samples[j][a] + w * (samples[j + 1][a] - samples[j][a]);
+				double eHold = samples[i][a] - actual, ePred = out[a] - actual;
+				sumHold += eHold * eHold;
+				sumPred += ePred * ePred;
+				sumAxis[a] += ePred * ePred;
+				if (fabs(ePred) > maxPred) {
+					maxPred = fabs(ePred);
+				}
+			}
+			++count;
+		}
+		if (count == 0) {
+			continue;
+		}
+		printf("%8.1f   %.6f   %.6f   %.6f   |", leads[l] * 1e3, sqrt(sumHold / (count * AxisCount)),
+			sqrt(sumPred / (count * AxisCount)), maxPred);
+		for (int a = 0; a < AxisCount; ++a) {
+			printf(" %s %.5f", names[a], sqrt(sumAxis[a] / count));
+		}
+		printf("\n");
+	}
+	return 0;
+}
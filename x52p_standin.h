@@ -0,0 +1,410 @@
+// ---------------------------------------------------------------------------------------------------------- //
+// Osaka University: Dimas M. Rachman, 2022.
+// Stand-in DirectInput and DirectOutput for the tools (x52p_stress.cpp, x52p_bench.cpp): game controllers in
+// memory, no HOTAS and no DirectOutput.dll needed. Saitek/Logitech x52 pro HOTAS.
+
+// HOW TO USE
+// Include it once, in the .cpp of the tool, after x52p_ctrl.cpp. It defines DirectInput8Create() and the
+// DirectOutput_* functions used by x52p_ctrl, so DirectInput and DirectOutput are never loaded: every x52p_ctrl
+// of the program reads the stand-in devices. Compile as TESTWORKX52P.cpp (same headers and libraries).
+//	StandinReset(count)			count x52 pro plugged in, joystick ID 0, 1, ... (StandinMaxDevices at most), centered
+//	standin[i].state			what GetDeviceState() gives, StandinSetInput() also signals the input event
+//	StandinUnplug/StandinPlug	hot-plug: reads fail with DIERR_INPUTLOST, DirectOutput device callback
+//	StandinShowPage				scroll wheel of the MFD: page callback of the device
+// The counters (COM objects alive, DirectOutput initialized, writes) let the tools check what is left behind.
+// StandinSetInput(), StandinUnplug(), and StandinPlug() may be called from another thread than the reads.
+// ---------------------------------------------------------------------------------------------------------- //
+
+#pragma once
+
+const int StandinMaxDevices = 8;
+const int StandinMaxPages = 32;
+
+// One game controller: its DirectInput side and, for a x52 pro, its DirectOutput side
+struct StandinDevice
+{
+	DIJOYSTATE2 state;		// Given by GetDeviceState()
+	int plugged;			// 0: reads and acquire fail, no DirectOutput device
+	int x52pro;				// 1: has a MFD and LEDs (DirectOutput), 0: another game controller
+	HANDLE event;			// SetEventNotification(), NULL if none
+	int acquired;
+	Pfn_DirectOutput_PageChange pageCb;			// Callbacks registered on the DirectOutput device, NULL if none
+	void* pageCtx;
+	Pfn_DirectOutput_SoftButtonChange buttonCb;
+	void* buttonCtx;
+	unsigned int pages;		// Bit p: DirectOutput page p added
+	DWORD leds[LEDCount];	// Last DirectOutput_SetLed() of each LED
+};
+
+StandinDevice standin[StandinMaxDevices];
+int standinCount = 0;			// Game controllers, see StandinReset()
+long standinLive = 0;			// DirectInput objects and devices not released
+int standinDOInit = 0;			// DirectOutput_Initialize() not yet deinitialized
+long long standinWrites = 0;	// DirectOutput_SetLed() and DirectOutput_SetString() calls
+static Pfn_DirectOutput_DeviceChange standinDeviceCb = NULL;
+static std::mutex standinInputLock;		// The DirectInput side (state, plugged, acquired, event) of the devices
+
+// Instance GUID of a stand-in device, the same for DirectInput and DirectOutput
+GUID StandinGuid(int i) {
+	GUID g = { 0x5743d300, 0x7f1e, 0x4a52, { 0x8e, 0x52, 0x58, 0x35, 0x32, 0x50, 0x00, 0x00 } };
+	g.Data1 += i;
+	return g;
+}
+
+// Index of a stand-in device from its DirectInput instance GUID, -1 if none
+int StandinFindGuid(const GUID& g) {
+	for (int i = 0; i < standinCount; ++i) {
+		if (IsEqualGUID(g, StandinGuid(i))) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+// Index of a stand-in device from its DirectOutput handle, -1 if none
+int StandinFindHandle(void* hDevice) {
+	for (int i = 0; i < standinCount; ++i) {
+		if (hDevice == (void*)&standin[i]) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+//////////////////////////// DIRECTINPUT //////////////////////////////////
+// The interfaces of dinput.h, every method is there. The ones x52p_ctrl does not use return DIERR_UNSUPPORTED.
+class StandinDirectInputDevice final : public IDirectInputDevice8
+{
+public:
+	StandinDirectInputDevice(int i) : idx(i), refs(1) { ++standinLive; }
+
+	// IUnknown
+	HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, LPVOID* obj) { *obj = NULL; return E_NOINTERFACE; }
+	ULONG STDMETHODCALLTYPE AddRef() { return ++refs; }
+	ULONG STDMETHODCALLTYPE Release() {
+		if (--refs > 0) {
+			return refs;
+		}
+		--standinLive;
+		delete this;
+		return 0;
+	}
+
+	// IDirectInputDevice8
+	HRESULT STDMETHODCALLTYPE GetCapabilities(LPDIDEVCAPS caps) {
+		ZeroMemory(caps, sizeof(DIDEVCAPS));
+		caps->dwSize = sizeof(DIDEVCAPS);
+		caps->dwFlags = DIDC_ATTACHED;
+		caps->dwAxes = 7;
+		caps->dwButtons = 39;
+		caps->dwPOVs = 1;
+		return DI_OK;
+	}
+	HRESULT STDMETHODCALLTYPE EnumObjects(LPDIENUMDEVICEOBJECTSCALLBACK cb, LPVOID ctx, DWORD flags) { return DIERR_UNSUPPORTED; }
+	HRESULT STDMETHODCALLTYPE GetProperty(REFGUID prop, LPDIPROPHEADER header) { return DIERR_UNSUPPORTED; }
+	HRESULT STDMETHODCALLTYPE SetProperty(REFGUID prop, LPCDIPROPHEADER header) { return DIERR_UNSUPPORTED; }
+	HRESULT STDMETHODCALLTYPE Acquire() {
+		std::lock_guard<std::mutex> lock(standinInputLock);
+		if (!standin[idx].plugged) {
+			return DIERR_UNPLUGGED;
+		}
+		standin[idx].acquired = 1;
+		return DI_OK;
+	}
+	HRESULT STDMETHODCALLTYPE Unacquire() {
+		std::lock_guard<std::mutex> lock(standinInputLock);
+		standin[idx].acquired = 0;
+		return DI_OK;
+	}
+	HRESULT STDMETHODCALLTYPE GetDeviceState(DWORD size, LPVOID data) {
+		std::lock_guard<std::mutex> lock(standinInputLock);
+		if (!standin[idx].plugged) {
+			return DIERR_INPUTLOST;
+		}
+		if (!standin[idx].acquired) {
+			return DIERR_NOTACQUIRED;
+		}
+		memcpy(data, &standin[idx].state, (size < sizeof(DIJOYSTATE2)) ? size : sizeof(DIJOYSTATE2));
+		return DI_OK;
+	}
+	HRESULT STDMETHODCALLTYPE GetDeviceData(DWORD size, LPDIDEVICEOBJECTDATA data, LPDWORD count, DWORD flags) { return DIERR_UNSUPPORTED; }
+	HRESULT STDMETHODCALLTYPE SetDataFormat(LPCDIDATAFORMAT format) { return DI_OK; }
+	HRESULT STDMETHODCALLTYPE SetEventNotification(HANDLE event) {
+		std::lock_guard<std::mutex> lock(standinInputLock);
+		standin[idx].event = event;
+		return DI_OK;
+	}
+	HRESULT STDMETHODCALLTYPE SetCooperativeLevel(HWND window, DWORD flags) { return DI_OK; }
+	HRESULT STDMETHODCALLTYPE GetObjectInfo(LPDIDEVICEOBJECTINSTANCE info, DWORD obj, DWORD how) { return DIERR_UNSUPPORTED; }
+	HRESULT STDMETHODCALLTYPE GetDeviceInfo(LPDIDEVICEINSTANCE info) {
+		info->guidInstance = StandinGuid(idx);
+		return DI_OK;
+	}
+	HRESULT STDMETHODCALLTYPE RunControlPanel(HWND owner, DWORD flags) { return DIERR_UNSUPPORTED; }
+	HRESULT STDMETHODCALLTYPE Initialize(HINSTANCE inst, DWORD version, REFGUID guid) { return DI_OK; }
+	HRESULT STDMETHODCALLTYPE CreateEffect(REFGUID guid, LPCDIEFFECT eff, LPDIRECTINPUTEFFECT* out, LPUNKNOWN outer) { return DIERR_UNSUPPORTED; }
+	HRESULT STDMETHODCALLTYPE EnumEffects(LPDIENUMEFFECTSCALLBACK cb, LPVOID ctx, DWORD type) { return DIERR_UNSUPPORTED; }
+	HRESULT STDMETHODCALLTYPE GetEffectInfo(LPDIEFFECTINFO info, REFGUID guid) { return DIERR_UNSUPPORTED; }
+	HRESULT STDMETHODCALLTYPE GetForceFeedbackState(LPDWORD out) { return DIERR_UNSUPPORTED; }
+	HRESULT STDMETHODCALLTYPE SendForceFeedbackCommand(DWORD flags) { return DIERR_UNSUPPORTED; }
+	HRESULT STDMETHODCALLTYPE EnumCreatedEffectObjects(LPDIENUMCREATEDEFFECTOBJECTSCALLBACK cb, LPVOID ctx, DWORD flags) { return DIERR_UNSUPPORTED; }
+	HRESULT STDMETHODCALLTYPE Escape(LPDIEFFESCAPE esc) { return DIERR_UNSUPPORTED; }
+	HRESULT STDMETHODCALLTYPE Poll() { return standin[idx].plugged ? DI_NOEFFECT : DIERR_INPUTLOST; }
+	HRESULT STDMETHODCALLTYPE SendDeviceData(DWORD size, LPCDIDEVICEOBJECTDATA data, LPDWORD count, DWORD flags) { return DIERR_UNSUPPORTED; }
+	HRESULT STDMETHODCALLTYPE EnumEffectsInFile(LPCTSTR file, LPDIENUMEFFECTSINFILECALLBACK cb, LPVOID ctx, DWORD flags) { return DIERR_UNSUPPORTED; }
+	HRESULT STDMETHODCALLTYPE WriteEffectToFile(LPCTSTR file, DWORD count, LPDIFILEEFFECT effects, DWORD flags) { return DIERR_UNSUPPORTED; }
+	HRESULT STDMETHODCALLTYPE BuildActionMap(LPDIACTIONFORMAT format, LPCTSTR user, DWORD flags) { return DIERR_UNSUPPORTED; }
+	HRESULT STDMETHODCALLTYPE SetActionMap(LPDIACTIONFORMAT format, LPCTSTR user, DWORD flags) { return DIERR_UNSUPPORTED; }
+	HRESULT STDMETHODCALLTYPE GetImageInfo(LPDIDEVICEIMAGEINFOHEADER header) { return DIERR_UNSUPPORTED; }
+
+private:
+	int idx;	// In standin[]
+	ULONG refs;
+};
+
+class StandinDirectInput final : public IDirectInput8
+{
+public:
+	StandinDirectInput() : refs(1) { ++standinLive; }
+
+	// IUnknown
+	HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, LPVOID* obj) { *obj = NULL; return E_NOINTERFACE; }
+	ULONG STDMETHODCALLTYPE AddRef() { return ++refs; }
+	ULONG STDMETHODCALLTYPE Release() {
+		if (--refs > 0) {
+			return refs;
+		}
+		--standinLive;
+		delete this;
+		return 0;
+	}
+
+	// IDirectInput8
+	HRESULT STDMETHODCALLTYPE CreateDevice(REFGUID guid, LPDIRECTINPUTDEVICE8* dev, LPUNKNOWN outer) {
+		int i = StandinFindGuid(guid);
+		if (i < 0 || !standin[i].plugged) {
+			*dev = NULL;
+			return DIERR_DEVICENOTREG;
+		}
+		*dev = new StandinDirectInputDevice(i);
+		return DI_OK;
+	}
+	HRESULT STDMETHODCALLTYPE EnumDevices(DWORD type, LPDIENUMDEVICESCALLBACK cb, LPVOID ctx, DWORD flags) {
+		for (int i = 0; i < standinCount; ++i) {
+			if (!standin[i].plugged) {
+				continue;
+			}
+			DIDEVICEINSTANCE inst;
+			ZeroMemory(&inst, sizeof(inst));
+			inst.dwSize = sizeof(inst);
+			inst.guidInstance = StandinGuid(i);
+			if (cb(&inst, ctx) == DIENUM_STOP) {
+				break;
+			}
+		}
+		return DI_OK;
+	}
+	HRESULT STDMETHODCALLTYPE GetDeviceStatus(REFGUID guid) { int i = StandinFindGuid(guid); return (i >= 0 && standin[i].plugged) ? DI_OK : DI_NOTATTACHED; }
+	HRESULT STDMETHODCALLTYPE RunControlPanel(HWND owner, DWORD flags) { return DIERR_UNSUPPORTED; }
+	HRESULT STDMETHODCALLTYPE Initialize(HINSTANCE inst, DWORD version) { return DI_OK; }
+	HRESULT STDMETHODCALLTYPE FindDevice(REFGUID cls, LPCTSTR name, LPGUID out) { return DIERR_UNSUPPORTED; }
+	HRESULT STDMETHODCALLTYPE EnumDevicesBySemantics(LPCTSTR user, LPDIACTIONFORMAT format, LPDIENUMDEVICESBYSEMANTICSCB cb, LPVOID ctx, DWORD flags) { return DIERR_UNSUPPORTED; }
+	HRESULT STDMETHODCALLTYPE ConfigureDevices(LPDICONFIGUREDEVICESCALLBACK cb, LPDICONFIGUREDEVICESPARAMS params, DWORD flags, LPVOID ctx) { return DIERR_UNSUPPORTED; }
+
+private:
+	ULONG refs;
+};
+
+extern "C" HRESULT WINAPI DirectInput8Create(HINSTANCE inst, DWORD version, REFIID riid, LPVOID* out, LPUNKNOWN outer) {
+	*out = (IDirectInput8*)new StandinDirectInput;
+	return DI_OK;
+}
+
+//////////////////////////// DIRECTOUTPUT /////////////////////////////////
+// The DirectOutput handle of a x52 pro is the address of its StandinDevice.
+extern "C" {
+
+HRESULT __stdcall DirectOutput_Initialize(const wchar_t* wszPluginName) {
+	++standinDOInit;
+	return S_OK;
+}
+
+HRESULT __stdcall DirectOutput_Deinitialize() {
+	--standinDOInit;
+	standinDeviceCb = NULL;
+	for (int i = 0; i < standinCount; ++i) {	// Registrations and pages go with the library
+		standin[i].pageCb = NULL;
+		standin[i].pageCtx = NULL;
+		standin[i].buttonCb = NULL;
+		standin[i].buttonCtx = NULL;
+		standin[i].pages = 0;
+	}
+	return S_OK;
+}
+
+HRESULT __stdcall DirectOutput_RegisterDeviceCallback(Pfn_DirectOutput_DeviceChange pfnCb, void* pCtxt) {
+	standinDeviceCb = pfnCb;
+	return S_OK;
+}
+
+HRESULT __stdcall DirectOutput_Enumerate(Pfn_DirectOutput_EnumerateCallback pfnCb, void* pCtxt) {
+	for (int i = 0; i < standinCount; ++i) {
+		if (standin[i].plugged && standin[i].x52pro) {
+			pfnCb((void*)&standin[i], pCtxt);
+		}
+	}
+	return S_OK;
+}
+
+HRESULT __stdcall DirectOutput_RegisterPageCallback(void* hDevice, Pfn_DirectOutput_PageChange pfnCb, void* pCtxt) {
+	int i = StandinFindHandle(hDevice);
+	if (i < 0 || !standin[i].plugged) {
+		return E_HANDLE;
+	}
+	standin[i].pageCb = pfnCb;
+	standin[i].pageCtx = pCtxt;
+	return S_OK;
+}
+
+HRESULT __stdcall DirectOutput_RegisterSoftButtonCallback(void* hDevice, Pfn_DirectOutput_SoftButtonChange pfnCb, void* pCtxt) {
+	int i = StandinFindHandle(hDevice);
+	if (i < 0 || !standin[i].plugged) {
+		return E_HANDLE;
+	}
+	standin[i].buttonCb = pfnCb;
+	standin[i].buttonCtx = pCtxt;
+	return S_OK;
+}
+
+HRESULT __stdcall DirectOutput_GetDeviceType(void* hDevice, LPGUID pGuid) {
+	*pGuid = DeviceType_X52Pro;
+	return (StandinFindHandle(hDevice) < 0) ? E_HANDLE : S_OK;
+}
+
+HRESULT __stdcall DirectOutput_GetDeviceInstance(void* hDevice, LPGUID pGuid) {
+	int i = StandinFindHandle(hDevice);
+	if (i < 0) {
+		return E_HANDLE;
+	}
+	*pGuid = StandinGuid(i);
+	return S_OK;
+}
+
+HRESULT __stdcall DirectOutput_GetSerialNumber(void* hDevice, wchar_t* pszSerialNumber, DWORD dwSize) {
+	int i = StandinFindHandle(hDevice);
+	if (i < 0 || dwSize < 16) {
+		return E_HANDLE;
+	}
+	swprintf(pszSerialNumber, dwSize, L"STANDIN%d", i);
+	return S_OK;
+}
+
+HRESULT __stdcall DirectOutput_AddPage(void* hDevice, DWORD dwPage, const wchar_t* wszDebugName, DWORD dwFlags) {
+	int i = StandinFindHandle(hDevice);
+	if (i < 0 || !standin[i].plugged || dwPage >= (DWORD)StandinMaxPages) {
+		return E_HANDLE;
+	}
+	standin[i].pages |= 1u << dwPage;
+	return S_OK;
+}
+
+HRESULT __stdcall DirectOutput_RemovePage(void* hDevice, DWORD dwPage) {
+	int i = StandinFindHandle(hDevice);
+	if (i < 0 || !standin[i].plugged || dwPage >= (DWORD)StandinMaxPages || !(standin[i].pages >> dwPage & 1)) {
+		return E_HANDLE;
+	}
+	standin[i].pages &= ~(1u << dwPage);
+	return S_OK;
+}
+
+HRESULT __stdcall DirectOutput_SetLed(void* hDevice, DWORD dwPage, DWORD dwIndex, DWORD dwValue) {
+	++standinWrites;
+	int i = StandinFindHandle(hDevice);
+	if (i < 0 || !standin[i].plugged || dwIndex >= (DWORD)LEDCount) {
+		return E_HANDLE;
+	}
+	standin[i].leds[dwIndex] = dwValue;
+	return S_OK;
+}
+
+HRESULT __stdcall DirectOutput_SetString(void* hDevice, DWORD dwPage, DWORD dwIndex, DWORD cchValue, const wchar_t* wszValue) {
+	++standinWrites;
+	int i = StandinFindHandle(hDevice);
+	return (i < 0 || !standin[i].plugged) ? E_HANDLE : S_OK;
+}
+
+}
+
+//////////////////////////// TOOL SIDE ////////////////////////////////////
+// Start again with count x52 pro plugged in, centered, nothing registered. Before creating the objects.
+void StandinReset(int count) {
+	standinCount = (count < StandinMaxDevices) ? count : StandinMaxDevices;
+	for (int i = 0; i < StandinMaxDevices; ++i) {
+		StandinDevice* d = &standin[i];
+		ZeroMemory(d, sizeof(StandinDevice));
+		d->plugged = (i < standinCount);
+		d->x52pro = 1;
+		LONG* axes = &d->state.lX;
+		for (int a = 0; a < 6; ++a) {
+			axes[a] = 32767;	// X, Y, Z, RX, RY, RZ centered
+		}
+		for (int p = 0; p < 4; ++p) {
+			d->state.rgdwPOV[p] = 0xFFFFFFFF;	// Centered hats
+		}
+	}
+	standinWrites = 0;
+}
+
+// New input on a device: the state changes and the event is signaled, as DirectInput does
+void StandinSetInput(int i, const DIJOYSTATE2* state) {
+	std::lock_guard<std::mutex> lock(standinInputLock);
+	standin[i].state = *state;
+	if (standin[i].event != NULL) {
+		SetEvent(standin[i].event);
+	}
+}
+
+// Unplug a device: reads fail, its DirectOutput device goes with its callbacks and pages
+// DirectInput signals the event when the device is lost, a waiting loop wakes up to see it
+void StandinUnplug(int i) {
+	{
+		std::lock_guard<std::mutex> lock(standinInputLock);
+		standin[i].plugged = 0;
+		standin[i].acquired = 0;
+		if (standin[i].event != NULL) {
+			SetEvent(standin[i].event);
+		}
+	}
+	if (standin[i].x52pro && standinDeviceCb != NULL) {
+		standinDeviceCb((void*)&standin[i], false, NULL);
+	}
+	standin[i].pageCb = NULL;
+	standin[i].pageCtx = NULL;
+	standin[i].buttonCb = NULL;
+	standin[i].buttonCtx = NULL;
+	standin[i].pages = 0;
+}
+
+// Plug a device in again, with the same identity (instance GUID)
+void StandinPlug(int i) {
+	{
+		std::lock_guard<std::mutex> lock(standinInputLock);
+		standin[i].plugged = 1;
+	}
+	if (standin[i].x52pro && standinDeviceCb != NULL) {
+		standinDeviceCb((void*)&standin[i], true, NULL);
+	}
+}
+
+// Scroll the MFD to a page: the page callback hides the shown page and shows the new one
+// Returns 0 if no callback is registered on the device
+int StandinShowPage(int i, DWORD shown, DWORD page) {
+	if (standin[i].pageCb == NULL) {
+		return 0;
+	}
+	standin[i].pageCb((void*)&standin[i], shown, false, standin[i].pageCtx);
+	if (standin[i].pageCb != NULL) {
+		standin[i].pageCb((void*)&standin[i], page, true, standin[i].pageCtx);
+	}
+	return 1;
+}
@@ -0,0 +1,380 @@
+// ---------------------------------------------------------------------------------------------------------- //
+// Osaka University: Dimas M. Rachman, 2022.
+// Stress test of the life cycle of x52p_ctrl against the stand-in devices of x52p_standin.h.
+// Saitek/Logitech x52 pro HOTAS.
+
+// REQUIREMENTS
+// Same as TESTWORKX52P.cpp: x52p_ctrl.h, x52p_ctrl.cpp, x52p_standin.h, and the DirectX SDK and DirectOutput
+// files to compile. No HOTAS is needed to run it. The async test needs C++20 (/std:c++20, see x52p_async.h),
+// it is left out of a build with an older standard.
+
+// HOW TO USE
+// x52p_stress [name ...]		runs the named tests, all of them without a name, returns 1 if one fails
+//		blocks	several blocks (x52p_ctrl) created and deleted in changing orders, two of them on the same x52 pro,
+//				with the x52 pro unplugged and plugged in again: no DirectOutput callback left to a deleted
+//				block, no page left on a device without block, and at the end no DirectInput object alive,
+//				DirectOutput deinitialized, and the device registry empty
+//		shared	sources opened with OPEN_INPUT_SHARED, alone and next to a block with DirectOutput, created and
+//				deleted in changing orders: one DirectInput and one enumeration for all of them, no DirectOutput,
+//				each reads its own device, alone and through a threaded x52p_fusion, and a shared source leaves
+//				the input event and the acquisition of its device to the block with DirectOutput
+//		event	WaitForInput() with the input event: wakes up on new input, returns 0 at its timeout without input,
+//				and with the device unplugged wakes up, then times out (never blocks), reports the lost input
+//				through the watchdog, and reads again once the device is plugged in
+//		async	x52p_async: ButtonPressed() on the press only, AxisCrossed() both ways with the value, NextChange()
+//				on its fields only, a coroutine waiting again from its resume (the same field, then another)
+//				resumed at the next change and not in the same poll, and the frames left freed with x52p_async
+// Run it under a memory checker (e.g. AddressSanitizer) too, a callback to a deleted block is a use after free.
+// ---------------------------------------------------------------------------------------------------------- //
+
+#include "x52p_ctrl.h"				// External dependency file, header file
+#include "x52p_ctrl.cpp"			// Functions definitions
+#include "x52p_standin.h"			// Stand-in DirectInput and DirectOutput
+#if __cplusplus >= 202002L || (defined(_MSVC_LANG) && _MSVC_LANG >= 202002L)
+#define X52P_STRESS_ASYNC
+#include "x52p_async.h"				// Coroutines, C++20
+#endif
+
+static int failures = 0;
+
+// Count and print a failed check
+void Check(int ok, const char* what, int cycle) {
+	if (!ok) {
+		if (failures < 20) {
+			printf("  FAILED: %s (cycle %d)\n", what, cycle);
+		}
+		++failures;
+	}
+}
+
+//////////////////////////// BLOCKS ///////////////////////////////////////
+const int Blocks = 4;
+const int blockIds[Blocks] = { 0, 1, 2, 0 };	// Joystick IDs, two blocks on the x52 pro 0
+const int Cycles = 10000;
+
+// The callbacks of every device reach a live block with the joystick ID of the device, and a device without
+// block has no callback and no page left
+void CheckDevices(x52p_ctrl* blocks[Blocks], int cycle) {
+	for (int i = 0; i < standinCount; ++i) {
+		int owners = 0, reached = (standin[i].pageCb == NULL);
+		for (int b = 0; b < Blocks; ++b) {
+			if (blocks[b] != NULL && blockIds[b] == i) {
+				++owners;
+				reached |= (standin[i].pageCtx == (void*)blocks[b] && standin[i].buttonCtx == (void*)blocks[b]);
+			}
+		}
+		Check(reached, "page or soft button callback to a deleted block", cycle);
+		if (owners == 0) {
+			Check(standin[i].pageCb == NULL && standin[i].buttonCb == NULL, "callback left on a device without block", cycle);
+			Check(standin[i].pages == 0, "page left on a device without block", cycle);
+		}
+		else {
+			Check(standin[i].pageCb != NULL, "no page callback on a device with a block", cycle);
+			Check(standin[i].pages != 0, "no page on a device with a block", cycle);
+		}
+	}
+}
+
+int TestBlocks() {
+	x52p_ctrl* blocks[Blocks] = { NULL };
+	StandinReset(3);
+	for (int cycle = 0; cycle < Cycles; ++cycle) {
+		for (int k = 0; k < Blocks; ++k) {
+			int b = (k + cycle) % Blocks;	// Created in a changing order
+			blocks[b] = new x52p_ctrl(blockIds[b]);
+		}
+		CheckDevices(blocks, cycle);
+
+		if (cycle % 7 == 3) {	// Hot-plug: the callbacks and pages must come back with the device
+			int dev = (cycle / 7) % standinCount;
+			StandinUnplug(dev);
+			StandinPlug(dev);
+			CheckDevices(blocks, cycle);
+		}
+		for (int i = 0; i < standinCount; ++i) {
+			StandinShowPage(i, 1, 1);	// Scroll the MFD: reaches a live block
+		}
+
+		for (int k = 0; k < Blocks; ++k) {
+			int b = (k * 3 + cycle) % Blocks;	// Deleted in another order
+			delete blocks[b];
+			blocks[b] = NULL;
+			CheckDevices(blocks, cycle);
+			for (int i = 0; i < standinCount; ++i) {
+				StandinShowPage(i, 1, 1);
+			}
+		}
+	}
+	Check(standinLive == 0, "DirectInput objects not released", Cycles);
+	Check(standinDOInit == 0, "DirectOutput not deinitialized", Cycles);
+	Check(DOuserCount == 0 && DOdeviceCount == 0, "DirectOutput registry not empty", Cycles);
+	printf("blocks: %d cycles of %d blocks, %d failed checks\n", Cycles, Blocks, failures);
+	return failures == 0;
+}
+
+//////////////////////////// SHARED DIRECTINPUT ///////////////////////////
+const int Sources = 3;
+const int SharedCycles = 2000;
+
+int TestShared() {
+	x52p_ctrl* src[Sources] = { NULL };
+	StandinReset(Sources);
+	for (int cycle = 0; cycle < SharedCycles; ++cycle) {
+		x52p_ctrl* full = (cycle % 2) ? new x52p_ctrl(0) : NULL;	// Owns its own DirectInput and DirectOutput
+		long fullLive = (full != NULL) ? 1 + standinCount : 0;
+		if (full != NULL) {
+			Check(full->SetInputEvent(1), "no input event on the device of the block", cycle);
+		}
+		for (int k = 0; k < Sources; ++k) {
+			int i = (k + cycle) % Sources;
+			src[i] = new x52p_ctrl(i, OPEN_INPUT_SHARED);
+			Check(standinLive == fullLive + 1 + standinCount, "shared sources did not enumerate once", cycle);
+			Check(src[i]->GetDevCount() == standinCount, "shared source without the devices", cycle);
+		}
+		Check(standinDOInit == (full != NULL), "DirectOutput initialized by a shared source", cycle);
+		Check(src[0]->SetInputEvent(1) == 0, "input event set on a shared device", cycle);
+
+		for (int i = 0; i < Sources; ++i) {	// Each reads its own device
+			DIJOYSTATE2 st = standin[i].state;
+			st.lX = 1000 * (i + 1) + cycle % 100;
+			StandinSetInput(i, &st);
+		}
+		for (int i = 0; i < Sources; ++i) {
+			src[i]->GetState();
+			Check(src[i]->GetCompactState().axes[0] == 1000 * (i + 1) + cycle % 100, "shared source read another device", cycle);
+		}
+		if (cycle % 50 == 0) {	// Through the reading threads of x52p_fusion
+			x52p_fusion f;
+			FusionChannel ch[Sources];
+			for (int i = 0; i < Sources; ++i) {
+				f.AddSource(src[i]);
+				ch[i] = { i, FUSE_AXIS, 5, 1.0 };	// RZ, centered
+			}
+			f.SetLayout(ch, Sources);
+			f.Start(1, 0.05);
+			double out[Sources];
+			for (int step = 0; step < 20; ++step) {
+				Check(f.Step(out) == Sources, "shared source not read in time by x52p_fusion", cycle);
+			}
+			for (int i = 0; i < Sources; ++i) {
+				Check(out[i] == 0, "x52p_fusion gave a wrong axis of a shared source", cycle);
+			}
+		}
+
+		for (int k = 0; k < Sources; ++k) {
+			int i = (k * 2 + cycle) % Sources;	// Deleted in another order, the last one releases DirectInput
+			delete src[i];
+			src[i] = NULL;
+			long left = (k < Sources - 1) ? 1 + standinCount : 0;
+			Check(standinLive == fullLive + left, "shared DirectInput released too early or not at all", cycle);
+			if (full != NULL && left != 0) {
+				Check(standin[0].event != NULL && standin[0].acquired, "shared source took the device of the block", cycle);
+			}
+		}
+		delete full;
+	}
+	Check(standinLive == 0, "DirectInput objects not released", SharedCycles);
+	Check(standinDOInit == 0, "DirectOutput not deinitialized", SharedCycles);
+	printf("shared: %d cycles of %d sources, %d failed checks\n", SharedCycles, Sources, failures);
+	return failures == 0;
+}
+
+//////////////////////////// INPUT EVENT //////////////////////////////////
+const double WaitBound = 1.0;	// Seconds a wait may take at most in the checks, far above the timeouts used
+
+// WaitForInput(timeout) with the time it took (s)
+int TimedWait(x52p_ctrl* c, double timeout, double* took) {
+	long long t0 = x52p_now_ns();
+	int signaled = c->WaitForInput(timeout);
+	*took = (x52p_now_ns() - t0) * 1e-9;
+	return signaled;
+}
+
+int TestEvent() {
+	StandinReset(1);
+	x52p_ctrl* c = new x52p_ctrl(0);
+	c->SetWatchdog(0.05, 0);
+	Check(c->SetInputEvent(1), "no input event on the device", 0);
+	double took;
+	DIJOYSTATE2 st = standin[0].state;
+
+	// New input while waiting: wakes up and reads it
+	std::thread input([&] { Sleep(10); st.lX = 1234; StandinSetInput(0, &st); });
+	int signaled = TimedWait(c, 5.0, &took);
+	input.join();
+	Check(signaled == 1 && took < WaitBound, "no wake up on new input", 0);
+	Check(c->GetCompactState().axes[0] == 1234, "new input not read after the wake up", 0);
+
+	// No input: returns 0 at the timeout
+	signaled = TimedWait(c, 0.05, &took);
+	Check(signaled == 0, "wake up without input", 1);
+	Check(took >= 0.04 && took < WaitBound, "timeout not kept without input", 1);
+
+	// Unplugged while waiting: wakes up, the read fails
+	std::thread unplug([] { Sleep(10); StandinUnplug(0); });
+	TimedWait(c, 5.0, &took);
+	unplug.join();
+	Check(took < WaitBound, "wait blocked when the device was unplugged", 2);
+	Check(c->GetLastResult() == DIERR_INPUTLOST, "lost input not reported", 2);
+	Check(c->GetHealth() == HEALTH_DEGRADED, "not degraded after the device was unplugged", 2);
+
+	// Still unplugged: every wait times out, and the watchdog goes to stalled
+	for (int k = 0; k < 5; ++k) {
+		signaled = TimedWait(c, 0.02, &took);
+		Check(took < WaitBound, "wait blocked on an unplugged device", 3 + k);
+		Check(c->GetLastResult() != DI_OK, "read of an unplugged device did not fail", 3 + k);
+	}
+	Check(c->GetHealth() == HEALTH_STALLED, "not stalled after the bound without device", 8);
+
+	// Plugged in again: the watchdog acquires it, then the reads and the event work again
+	StandinPlug(0);
+	for (int k = 0; k < 3 && c->GetHealth() != HEALTH_OK; ++k) {
+		TimedWait(c, 0.02, &took);
+	}
+	Check(c->GetHealth() == HEALTH_OK && c->GetLastResult() == DI_OK, "no recovery after the device came back", 9);
+	st.lX = 4321;
+	StandinSetInput(0, &st);
+	signaled = TimedWait(c, 5.0, &took);
+	Check(signaled == 1 && took < WaitBound, "no wake up on input after the device came back", 9);
+	Check(c->GetCompactState().axes[0] == 4321, "input not read after the device came back", 9);
+
+	delete c;
+	Check(standinLive == 0, "DirectInput objects not released", 10);
+	printf("event: %d failed checks\n", failures);
+	return failures == 0;
+}
+
+//////////////////////////// COROUTINES ///////////////////////////////////
+#ifdef X52P_STRESS_ASYNC
+static int presses = 0, releases = 0, changes = 0, crossings = 0;
+static unsigned long long changed = 0;
+static double crossedAt = 0;
+
+// Waits again from its own resume: the press, then the release of the same button, then the press again
+x52p_task PressRelease(x52p_async& h, int button) {
+	for (;;) {
+		co_await h.ButtonPressed(button);
+		++presses;
+		co_await h.NextChange(X52P_FIELD_BIT(X52FieldButton0 + button));
+		++releases;
+	}
+}
+
+x52p_task HatChanges(x52p_async& h) {
+	for (;;) {
+		changed = co_await h.NextChange(X52P_FIELD_BIT(X52FieldHat) | X52P_FIELD_BIT(X52FieldMode));
+		++changes;
+	}
+}
+
+x52p_task CrossX(x52p_async& h) {
+	for (;;) {
+		crossedAt = co_await h.AxisCrossed(0, 0.5);
+		++crossings;
+	}
+}
+
+// Change the device and poll once
+int Step(x52p_async& h, DIJOYSTATE2* st) {
+	StandinSetInput(0, st);
+	return h.Poll();
+}
+
+int TestAsync() {
+	StandinReset(1);
+	x52p_ctrl* c = new x52p_ctrl(0);
+	DIJOYSTATE2 st = standin[0].state;
+	{
+		x52p_async h(*c);
+		PressRelease(h, 3);
+		HatChanges(h);
+		CrossX(h);
+		Check(h.GetWaiting() == 3, "coroutines not waiting after their start", 0);
+		Check(h.Poll() == 0, "resume at the first poll, it only takes the state", 0);
+
+		st.rgbButtons[3] = 0x80;	// Press: resumes the press only, the release wait added meanwhile waits
+		Step(h, &st);
+		Check(presses == 1 && releases == 0, "button press not resumed once", 1);
+		Step(h, &st);
+		Check(presses == 1 && releases == 0, "resume without change", 2);
+		st.rgbButtons[7] = 0x80;	// Another button: nobody waits on it
+		Step(h, &st);
+		Check(presses == 1 && releases == 0 && changes == 0, "resume on a field not waited on", 3);
+		st.rgbButtons[3] = 0;		// Release: the wait added from the resume
+		Step(h, &st);
+		Check(presses == 1 && releases == 1, "release not resumed by NextChange()", 4);
+		st.rgbButtons[3] = 0x80;	// And the press again
+		Step(h, &st);
+		Check(presses == 2 && releases == 1, "second press not resumed", 5);
+
+		st.rgdwPOV[0] = 9000;		// Hat right
+		Step(h, &st);
+		Check(changes == 1 && changed == X52P_FIELD_BIT(X52FieldHat), "hat change not given by NextChange()", 6);
+		st.rgbButtons[X52ModeButton] = 0x80;	// Mode 1, and the hat back
+		st.rgdwPOV[0] = 0xFFFFFFFF;
+		Step(h, &st);
+		Check(changes == 2 && changed == (X52P_FIELD_BIT(X52FieldHat) | X52P_FIELD_BIT(X52FieldMode)),
+			"hat and mode not given together by NextChange()", 7);
+
+		st.lX = 60000;				// X over 0.5: crossed, with the value of XJoy()
+		Step(h, &st);
+		Check(crossings == 1 && crossedAt > 0.5 && crossedAt == c->XJoy(), "axis crossing up not resumed", 8);
+		st.lX = 62000;				// Moved, same side
+		Step(h, &st);
+		Check(crossings == 1, "axis resumed without crossing", 9);
+		st.lX = 32767;				// Back under
+		Step(h, &st);
+		Check(crossings == 2 && crossedAt < 0.5, "axis crossing down not resumed", 10);
+		Check(h.GetWaiting() == 3, "coroutines lost after their resumes", 11);
+	}	// The three frames are freed here, a memory checker tells if not
+	delete c;
+	printf("async: %d failed checks\n", failures);
+	return failures == 0;
+}
+#endif
+
+//////////////////////////// MAIN /////////////////////////////////////////
+struct Test {
+	const char* name;
+	int (*run)();
+};
+
+const Test tests[] = {
+	{ "blocks", TestBlocks },
+	{ "shared", TestShared },
+	{ "event", TestEvent },
+#ifdef X52P_STRESS_ASYNC
+	{ "async", TestAsync },
+#endif
+};
+const int TestCount = sizeof(tests) / sizeof(tests[0]);
+
+int main(int argc, char** argv) {
+	for (int a = 1; a < argc; ++a) {
+		int t = 0;
+		while (t < TestCount && strcmp(argv[a], tests[t].name) != 0) {
+			++t;
+		}
+		if (t == TestCount) {
+			printf("Usage: x52p_stress [name ...], names:");
+			for (t = 0; t < TestCount; ++t) {
+				printf(" %s", tests[t].name);
+			}
+			printf("\n");
+			return 1;
+		}
+	}
+	int ok = 1;
+	for (int t = 0; t < TestCount; ++t) {
+		int run = (argc == 1);
+		for (int a = 1; a < argc; ++a) {
+			run |= (strcmp(argv[a], tests[t].name) == 0);
+		}
+		if (run) {
+			failures = 0;
+			ok &= tests[t].run();
+		}
+	}
+	printf(ok ? "OK\n" : "FAILED\n");
+	return ok ? 0 : 1;
+}